@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/history_search_bench.dir/bench/HistorySearch.cpp.o"
+  "CMakeFiles/history_search_bench.dir/bench/HistorySearch.cpp.o.d"
+  "history_search_bench"
+  "history_search_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/history_search_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
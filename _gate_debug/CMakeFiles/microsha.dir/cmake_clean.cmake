@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/microsha.dir/source/Main.cpp.o"
+  "CMakeFiles/microsha.dir/source/Main.cpp.o.d"
+  "microsha"
+  "microsha.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/microsha.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,135 @@
+// Замер скорости поиска по истории (Ctrl + R).
+// История из 500 000 смешанных команд порождается детерминированно, каждый запрос ищется с нуля,
+// набор "git commit" - по одному символу с уточнением предыдущего запроса. Выводится медиана и минимум по 21 повтору.
+//
+// Сборка и запуск:
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target history_search_bench
+//   ./build/history_search_bench
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "HistorySearch.hpp"
+
+// Генератор смешанной истории. Используются только сами значения mt19937, которые одинаковы во всех
+// реализациях стандартной библиотеки, в отличие от распределений.
+class HistoryGenerator
+{
+public:
+    std::string next()
+    {
+        switch (random() % 16)
+        {
+            case 0:  { return "git status"; }
+            case 1:  { return "git commit -m \"" + pick(verbs) + " " + pick(words) + "\""; }
+            case 2:  { return "git checkout -b feature/" + pick(words) + "-" + pick(words); }
+            case 3:  { return "git log --oneline -" + std::to_string(random() % 50) + " " + pick(files); }
+            case 4:  { return "git " + pick(git_commands) + " " + pick(files); }
+            case 5:  { return "ls " + pick(ls_flags) + " " + pick(directories); }
+            case 6:  { return "cd " + pick(directories) + "/" + pick(words); }
+            case 7:  { return "make -j" + std::to_string(1 + random() % 16) + " " + pick(targets); }
+            case 8:  { return "cmake --build build --target " + pick(targets) + " -j" + std::to_string(1 + random() % 16); }
+            case 9:  { return "g++ -O2 -Wall -std=c++17 -c " + pick(files) + " -o build/" + pick(words) + ".o"; }
+            case 10: { return "grep -rn \"" + pick(words) + "\" " + pick(directories) + " | wc -l"; }
+            case 11: { return "vim " + pick(directories) + "/" + pick(files); }
+            case 12: { return "ssh " + pick(words) + "@host" + std::to_string(random() % 100); }
+            case 13: { return "docker run --rm -it -v $PWD:/work " + pick(words) + ":latest bash"; }
+            case 14: { return "python3 scripts/" + pick(words) + ".py --input " + pick(files) + " --output /tmp/" + pick(words); }
+            default:
+            {
+                return "find " + pick(directories) + " -name \"*." + pick(extensions) + "\" | xargs grep -l " + pick(words) +
+                       " | sort | uniq -c | sort -rn | head -n " + std::to_string(random() % 100);
+            }
+        }
+    }
+
+protected:
+    std::mt19937 random{ 2024 };
+
+    const std::vector<std::string> verbs = { "fix", "add", "remove", "refactor", "update", "rename", "document", "test" };
+    const std::vector<std::string> words =
+    {
+        "parser", "history", "search", "index", "buffer", "memo", "cache", "plan", "stage", "pipe",
+        "signal", "terminal", "prompt", "highlight", "glob", "batch", "placement", "affinity", "builtin", "heredoc",
+        "alice", "bob", "deploy", "release", "config", "server", "client", "worker", "queue", "metrics"
+    };
+    const std::vector<std::string> git_commands = { "add", "diff", "push origin", "pull --rebase", "stash", "show", "blame", "restore" };
+    const std::vector<std::string> ls_flags = { "-la", "-l", "-a", "-lh", "-R", "-1", "-lt", "" };
+    const std::vector<std::string> directories = { "src", "include", "build", "/usr/lib", "/var/log", "~/projects", "docs", "/tmp" };
+    const std::vector<std::string> files =
+    {
+        "source/Main.cpp", "include/Plan.hpp", "include/Memo.hpp", "README.md", "CMakeLists.txt", "Makefile",
+        "src/main.c", "test/run.sh", "config.yaml", "notes.txt"
+    };
+    const std::vector<std::string> targets = { "all", "install", "clean", "microsha", "test", "docs" };
+    const std::vector<std::string> extensions = { "cpp", "hpp", "c", "h", "py", "txt", "md", "log" };
+
+    const std::string& pick(const std::vector<std::string>& list) { return list[random() % list.size()]; }
+};
+
+int main()
+{
+    const size_t entries = 500000;
+    const size_t repeats = 21;
+
+    HistorySearch::Index index;
+    HistoryGenerator generator;
+    for (size_t i = 0; i < entries; ++i) { index.add(generator.next()); }
+
+    // Медиана и минимум времени выполнения action в миллисекундах.
+    auto measure = [&](const std::string& name, auto&& prepare, auto&& action)
+    {
+        std::vector<double> times;
+        for (size_t repeat = 0; repeat < repeats; ++repeat)
+        {
+            prepare();
+            auto start = std::chrono::steady_clock::now();
+            action();
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        std::cout << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(2)
+                  << "медиана " << std::setw(6) << times[repeats / 2] << " мс, минимум " << std::setw(6) << times[0] << " мс";
+        if (!index.results().empty()) { std::cout << "  | " << index.entry(index.results()[0]); }
+        std::cout << std::endl;
+    };
+
+    std::cout << "Записей: " << entries << std::endl;
+    for (const std::string query : { "g", "gc", "gcm", "ls", "mk", "'make", "Make" })
+    {
+        measure("\"" + query + "\"", [&]() { index.search("#"); }, [&]() { index.search(query); });
+    }
+
+    // Набор запроса по одному символу: время каждого нажатия и худшее из них.
+    const std::string typed = "git commit";
+    double worst = 0;
+    std::string worst_query;
+    for (size_t length = 1; length <= typed.size(); ++length)
+    {
+        const std::string previous = typed.substr(0, length - 1);
+        const std::string query = typed.substr(0, length);
+        std::vector<double> times;
+        for (size_t repeat = 0; repeat < repeats; ++repeat)
+        {
+            index.search("#");
+            for (size_t k = 1; k < length; ++k) { index.search(typed.substr(0, k)); }
+            auto start = std::chrono::steady_clock::now();
+            index.search(query);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        if (times[repeats / 2] > worst)
+        {
+            worst = times[repeats / 2];
+            worst_query = query;
+        }
+    }
+    std::cout << "Набор \"" << typed << "\" по символу: худшее нажатие " << std::fixed << std::setprecision(2)
+              << worst << " мс (\"" << worst_query << "\")" << std::endl;
+    return 0;
+}
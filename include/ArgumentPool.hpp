@@ -0,0 +1,75 @@
+#ifndef ARGUMENT_POOL_HPP
+#define ARGUMENT_POOL_HPP
+#include <string>
+#include <vector>
+#include <cstring>
+#include <climits>
+
+// Linux.
+#include <unistd.h>
+
+extern char** environ;
+
+// Компактное хранилище аргументов: строки лежат подряд в одном буфере, разделённые '\0',
+// и передаются в exec без копирования по отдельности.
+class ArgumentPool
+{
+public:
+    // Добавление аргумента.
+    void push(const std::string& argument)
+    {
+        offsets.push_back(buffer.size());
+        buffer.append(argument);
+        buffer.push_back('\0');
+    }
+
+    // Число аргументов.
+    size_t size() const { return offsets.size(); }
+
+    // Отбрасывание всех аргументов, начиная с указанного.
+    void truncate(size_t count)
+    {
+        if (count >= offsets.size()) { return; }
+        buffer.resize(offsets[count]);
+        offsets.resize(count);
+    }
+
+    // Объём, занимаемый аргументами в пространстве exec: строки и массив указателей.
+    size_t cost() const { return buffer.size() + (offsets.size() + 1) * sizeof(char*); }
+    static size_t cost(const std::string& argument) { return argument.size() + 1 + sizeof(char*); }
+    static size_t cost(const std::vector<std::string>& arguments)
+    {
+        size_t result = sizeof(char*);
+        for (const std::string& argument : arguments) { result += cost(argument); }
+        return result;
+    }
+
+    // Массив указателей для exec, завершённый nullptr. Действителен до следующего изменения хранилища.
+    std::vector<char*> pointers()
+    {
+        std::vector<char*> result;
+        result.reserve(offsets.size() + 1);
+        for (size_t offset : offsets) { result.push_back(&buffer[offset]); }
+        result.push_back(nullptr);
+        return result;
+    }
+
+    // Допустимый объём аргументов одного exec: ARG_MAX за вычетом окружения и запаса (как у xargs).
+    static size_t limit()
+    {
+        const size_t headroom = 2048;
+        long arg_max = sysconf(_SC_ARG_MAX);
+        size_t result = (arg_max > 0) ? static_cast<size_t>(arg_max) : static_cast<size_t>(_POSIX_ARG_MAX);
+
+        size_t environment = sizeof(char*);
+        for (char** variable = environ; *variable != nullptr; ++variable) { environment += strlen(*variable) + 1 + sizeof(char*); }
+
+        return (result > environment + headroom) ? result - environment - headroom : 0;
+    }
+
+protected:
+    std::string buffer;          // Строки аргументов.
+    std::vector<size_t> offsets; // Начала строк.
+};
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef BUILTINS_HPP
+#define BUILTINS_HPP
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+
+// Linux.
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Variables.hpp"
+
+// Встроенные команды, выполняемые внутри оболочки в любой стадии конвейера.
+// Каждая команда получает аргументы после раскрытия шаблонов и переменных, дописывает стандартный вывод
+// в output и возвращает код завершения. Ошибки выводятся в стандартный поток ошибок оболочки.
+namespace Builtins
+{
+    using Function = int (*)(const std::vector<std::string>& args, std::string& output);
+
+    // Описание встроенной команды.
+    struct Builtin
+    {
+        Function function;
+        bool     modifies_state; // Меняет состояние оболочки: внутри конвейера выполняется в отдельном процессе.
+    };
+
+    // Разбор управляющих последовательностей вида "\n". Возвращает false, если встретилась "\c" (конец вывода).
+    inline bool unescape(const std::string& text, std::string& output)
+    {
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            if ((text[i] != '\\') || (i + 1 == text.size())) { output += text[i]; continue; }
+            switch (text[++i])
+            {
+                case 'n':  { output += '\n'; break; }
+                case 't':  { output += '\t'; break; }
+                case 'r':  { output += '\r'; break; }
+                case 'a':  { output += '\a'; break; }
+                case 'b':  { output += '\b'; break; }
+                case 'e':  { output += '\033'; break; }
+                case '\\': { output += '\\'; break; }
+                case 'c':  { return false; }
+                default:   { output += '\\'; output += text[i]; break; }
+            }
+        }
+        return true;
+    }
+
+    // echo [-n] [-e] аргументы...
+    inline int echo(const std::vector<std::string>& args, std::string& output)
+    {
+        bool newline = true;
+        bool escapes = false;
+        size_t i = 1;
+        for (; (i < args.size()) && ((args[i] == "-n") || (args[i] == "-e")); ++i)
+        {
+            if (args[i] == "-n") { newline = false; }
+            else { escapes = true; }
+        }
+
+        for (size_t first = i; i < args.size(); ++i)
+        {
+            if (i != first) { output += ' '; }
+            if (!escapes) { output += args[i]; }
+            else if (!unescape(args[i], output)) { return 0; }
+        }
+        if (newline) { output += '\n'; }
+        return 0;
+    }
+
+    // printf ФОРМАТ аргументы... Формат повторяется, пока не закончатся аргументы.
+    inline int printf(const std::vector<std::string>& args, std::string& output)
+    {
+        if (args.size() < 2)
+        {
+            std::cerr << "printf: не указан формат." << std::endl;
+            return 1;
+        }
+
+        const std::string& format = args[1];
+        size_t next = 2;
+        int status = 0;
+        do
+        {
+            bool consumed = false;
+            for (size_t i = 0; i < format.size(); ++i)
+            {
+                if (format[i] == '\\')
+                {
+                    size_t end = std::min(i + 2, format.size());
+                    if (!unescape(format.substr(i, end - i), output)) { return status; }
+                    i = end - 1;
+                    continue;
+                }
+                if ((format[i] != '%') || (i + 1 == format.size())) { output += format[i]; continue; }
+                if (format[i + 1] == '%') { output += '%'; ++i; continue; }
+
+                // Спецификатор: флаги, ширина, точность и преобразование передаются snprintf.
+                size_t end = i + 1;
+                while ((end < format.size()) && (std::string("-+ 0#").find(format[end]) != std::string::npos)) { ++end; }
+                while ((end < format.size()) && (isdigit(static_cast<unsigned char>(format[end])) || (format[end] == '.'))) { ++end; }
+                if (end == format.size())
+                {
+                    output += format.substr(i);
+                    break;
+                }
+                std::string specification = format.substr(i, end - i);
+                char conversion = format[end];
+                i = end;
+
+                std::string argument = (next < args.size()) ? args[next] : std::string();
+                if (next < args.size()) { ++next; consumed = true; }
+
+                char buffer[512];
+                int length = 0;
+                switch (conversion)
+                {
+                    case 's':
+                    {
+                        length = snprintf(buffer, sizeof(buffer), (specification + "s").c_str(), argument.c_str());
+                        if (length >= static_cast<int>(sizeof(buffer))) { output += argument; length = 0; }
+                        break;
+                    }
+                    case 'c':
+                    {
+                        length = snprintf(buffer, sizeof(buffer), (specification + "c").c_str(), argument.empty() ? '\0' : argument[0]);
+                        break;
+                    }
+                    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                    {
+                        char* number_end = nullptr;
+                        errno = 0;
+                        long long number = std::strtoll(argument.c_str(), &number_end, 0);
+                        if (!argument.empty() && ((*number_end != '\0') || errno))
+                        {
+                            std::cerr << "printf: " << argument << ": ожидалось число." << std::endl;
+                            status = 1;
+                        }
+                        length = snprintf(buffer, sizeof(buffer), (specification + "ll" + conversion).c_str(), number);
+                        break;
+                    }
+                    default:
+                    {
+                        std::cerr << "printf: неизвестное преобразование %" << conversion << "." << std::endl;
+                        return 1;
+                    }
+                }
+                output.append(buffer, std::max(0, std::min(length, static_cast<int>(sizeof(buffer)) - 1)));
+            }
+            if (!consumed) { break; }
+        }
+        while (next < args.size());
+        return status;
+    }
+
+    // get ИМЯ - вывод значения переменной среды.
+    inline int get(const std::vector<std::string>& args, std::string& output)
+    {
+        const char* ptr = (args.size() < 2) ? nullptr : Variables::get(args[1]);
+        if (ptr == nullptr)
+        {
+            std::cerr << "Ошибка операции с переменной среды." << std::endl;
+            return 1;
+        }
+        output += ptr;
+        output += '\n';
+        return 0;
+    }
+
+    inline int true_(const std::vector<std::string>&, std::string&)  { return 0; }
+    inline int false_(const std::vector<std::string>&, std::string&) { return 1; }
+
+    // Разбор целого числа для test.
+    inline bool parse_number(const std::string& text, long long& value)
+    {
+        char* end = nullptr;
+        errno = 0;
+        value = std::strtoll(text.c_str(), &end, 10);
+        return !text.empty() && (*end == '\0') && !errno;
+    }
+
+    // Вычисление выражения test без "!": 0 - истина, 1 - ложь, 2 - ошибка.
+    inline int evaluate(const std::vector<std::string>& expression)
+    {
+        switch (expression.size())
+        {
+            case 0: { return 1; }
+            case 1: { return expression[0].empty() ? 1 : 0; }
+            case 2:
+            {
+                const std::string& operation = expression[0];
+                const std::string& operand = expression[1];
+                if (operation == "-n") { return operand.empty() ? 1 : 0; }
+                if (operation == "-z") { return operand.empty() ? 0 : 1; }
+
+                struct stat info;
+                bool exists = (stat(operand.c_str(), &info) == 0);
+                if (operation == "-e") { return exists ? 0 : 1; }
+                if (operation == "-f") { return (exists && S_ISREG(info.st_mode)) ? 0 : 1; }
+                if (operation == "-d") { return (exists && S_ISDIR(info.st_mode)) ? 0 : 1; }
+                if (operation == "-s") { return (exists && (info.st_size > 0)) ? 0 : 1; }
+                if (operation == "-r") { return (access(operand.c_str(), R_OK) == 0) ? 0 : 1; }
+                if (operation == "-w") { return (access(operand.c_str(), W_OK) == 0) ? 0 : 1; }
+                if (operation == "-x") { return (access(operand.c_str(), X_OK) == 0) ? 0 : 1; }
+                break;
+            }
+            case 3:
+            {
+                const std::string& left = expression[0];
+                const std::string& operation = expression[1];
+                const std::string& right = expression[2];
+                if (operation == "=")  { return (left == right) ? 0 : 1; }
+                if (operation == "!=") { return (left != right) ? 0 : 1; }
+
+                long long a = 0;
+                long long b = 0;
+                if (!parse_number(left, a) || !parse_number(right, b)) { break; }
+                if (operation == "-eq") { return (a == b) ? 0 : 1; }
+                if (operation == "-ne") { return (a != b) ? 0 : 1; }
+                if (operation == "-lt") { return (a <  b) ? 0 : 1; }
+                if (operation == "-le") { return (a <= b) ? 0 : 1; }
+                if (operation == "-gt") { return (a >  b) ? 0 : 1; }
+                if (operation == "-ge") { return (a >= b) ? 0 : 1; }
+                break;
+            }
+            default: { break; }
+        }
+        std::cerr << "test: неверное выражение." << std::endl;
+        return 2;
+    }
+
+    // test ВЫРАЖЕНИЕ и [ ВЫРАЖЕНИЕ ].
+    inline int test(const std::vector<std::string>& args, std::string&)
+    {
+        std::vector<std::string> expression(args.begin() + 1, args.end());
+        if (args[0] == "[")
+        {
+            if (expression.empty() || (expression.back() != "]"))
+            {
+                std::cerr << "[: отсутствует ]." << std::endl;
+                return 2;
+            }
+            expression.pop_back();
+        }
+
+        bool negate = false;
+        while (!expression.empty() && (expression[0] == "!") && (expression.size() > 1))
+        {
+            negate = !negate;
+            expression.erase(expression.begin());
+        }
+
+        int result = evaluate(expression);
+        return ((result == 2) || !negate) ? result : 1 - result;
+    }
+
+    // cd [ДИРЕКТОРИЯ].
+    inline int cd(const std::vector<std::string>& args, std::string&)
+    {
+        const char* path = (args.size() < 2) ? std::getenv("HOME") : args[1].c_str();
+        if ((path == nullptr) || chdir(path))
+        {
+            std::cerr << "Ошибка при открытии файла." << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // set ИМЯ=ЗНАЧЕНИЕ.
+    inline int set(const std::vector<std::string>& args, std::string&)
+    {
+        // Ищем разделитель - знак "=".
+        size_t delimeter_position = 0; // Положение разделителя.
+        if ((args.size() < 2) || ((delimeter_position = args[1].find("=")) == std::string::npos))
+        {
+            std::cerr << "Неверная структура команды." << std::endl;
+            return 1;
+        }
+        size_t size = args[1].size();
+
+        // Положения и длины требуемых подстрок.
+        size_t name_position  = 0;
+        size_t name_length    = delimeter_position;
+        size_t value_position = delimeter_position + 1;
+        size_t value_length   = size - value_position;
+
+        // Обработка кавычек.
+        if ((value_length > 1) && (args[1][value_position] == '\"') && (args[1][value_position + value_length - 1] == '\"'))
+        {
+            ++value_position;
+            value_length -= 2;
+        }
+
+        std::string variable = args[1].substr(name_position, name_length);
+        std::string value = args[1].substr(value_position, value_length);
+
+        #ifdef DEBUG_ENV
+        std::cout << variable << " = " << value << std::endl;
+        #endif
+        setenv(variable.c_str(), value.c_str(), 1);
+        return 0;
+    }
+
+    // Таблица встроенных команд.
+    inline const std::unordered_map<std::string, Builtin>& table()
+    {
+        static const std::unordered_map<std::string, Builtin> builtins =
+        {
+            { "echo",   { echo,   false } },
+            { "printf", { printf, false } },
+            { "get",    { get,    false } },
+            { "true",   { true_,  false } },
+            { "false",  { false_, false } },
+            { "test",   { test,   false } },
+            { "[",      { test,   false } },
+            { "cd",     { cd,     true  } },
+            { "set",    { set,    true  } },
+        };
+        return builtins;
+    }
+
+    // Поиск встроенной команды. Возвращает nullptr, если команда внешняя.
+    inline const Builtin* find(const std::string& name)
+    {
+        auto found = table().find(name);
+        return (found == table().end()) ? nullptr : &found->second;
+    }
+}
+
+#endif
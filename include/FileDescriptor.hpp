@@ -0,0 +1,27 @@
+#ifndef FILE_DESCRIPTOR_HPP
+#define FILE_DESCRIPTOR_HPP
+#include <cstddef>
+#include <cerrno>
+
+// Linux.
+#include <unistd.h>
+
+// Запись всего буфера в файловый дескриптор с повтором после прерывания сигналом.
+// Возвращает false при ошибке записи (например, EPIPE, если читатель закрыл pipe).
+inline bool write_all(int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t count = write(fd, data, size);
+        if (count < 0)
+        {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef HIGHLIGHT_HPP
+#define HIGHLIGHT_HPP
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdlib>
+
+// Linux.
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Стили ANSI.
+#include "ANSI.hpp"
+
+// Подсветка синтаксиса вводимой команды.
+namespace Highlight
+{
+    // Индекс доступных команд: встроенные команды и исполняемые файлы из PATH.
+    // Строится один раз и обновляется не чаще одного раза на строку ввода, но никогда - на нажатие клавиши.
+    class CommandIndex
+    {
+    public:
+        // Регистрация встроенной команды.
+        void add_builtin(const std::string& name) { builtins.insert(name); }
+
+        // Обновление индекса перед вводом новой строки.
+        // Каталоги из PATH перечитываются только при изменении PATH или времени модификации каталога.
+        void refresh()
+        {
+            const char* ptr = std::getenv("PATH");
+            std::string path = (ptr == nullptr) ? std::string() : std::string(ptr);
+            if (!built || (path != cached_path))
+            {
+                cached_path = path;
+                directories.clear();
+                size_t position = 0;
+                while (position <= path.size())
+                {
+                    size_t colon = path.find(':', position);
+                    if (colon == std::string::npos) { colon = path.size(); }
+                    directories.push_back(Directory{ (colon == position) ? std::string(".") : path.substr(position, colon - position), 0, {} });
+                    position = colon + 1;
+                }
+                built = true;
+            }
+
+            bool changed = false;
+            for (Directory& directory : directories)
+            {
+                struct stat info;
+                time_t mtime = (stat(directory.path.c_str(), &info) == 0) ? info.st_mtime : 0;
+                if (directory.names.empty() || (mtime != directory.mtime))
+                {
+                    directory.mtime = mtime;
+                    directory.names = list_executables(directory.path);
+                    changed = true;
+                }
+            }
+            if (changed)
+            {
+                commands.clear();
+                for (const Directory& directory : directories) { commands.insert(directory.names.begin(), directory.names.end()); }
+            }
+
+            // Каталоги из путей вида "./script" кэшируются только в пределах одной строки.
+            listed.clear();
+        }
+
+        // Существует ли команда. Для имён с "/" каталог перечисляется один раз и кэшируется.
+        bool exists(const std::string& name)
+        {
+            if (name.find('/') == std::string::npos) { return (builtins.count(name) != 0) || (commands.count(name) != 0); }
+
+            size_t slash = name.rfind('/');
+            std::string directory = (slash == 0) ? std::string("/") : name.substr(0, slash);
+            auto found = listed.find(directory);
+            if (found == listed.end()) { found = listed.emplace(directory, list_executables(directory)).first; }
+            return found->second.count(name.substr(slash + 1)) != 0;
+        }
+
+    protected:
+        // Каталог из PATH.
+        struct Directory
+        {
+            std::string path;
+            time_t mtime;
+            std::unordered_set<std::string> names;
+        };
+
+        bool built = false;
+        std::string cached_path;
+        std::vector<Directory> directories;
+        std::unordered_set<std::string> commands;
+        std::unordered_set<std::string> builtins;
+        std::unordered_map<std::string, std::unordered_set<std::string>> listed;
+
+        // Имена исполняемых файлов каталога.
+        static std::unordered_set<std::string> list_executables(const std::string& path)
+        {
+            std::unordered_set<std::string> names;
+            std::error_code error;
+            for (auto iterator = std::filesystem::directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, error);
+                 !error && (iterator != std::filesystem::directory_iterator()); iterator.increment(error))
+            {
+                std::filesystem::file_status status = iterator->status(error);
+                if (error) { error.clear(); continue; }
+                if (std::filesystem::is_directory(status)) { continue; }
+                if ((status.permissions() & (std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec | std::filesystem::perms::others_exec))
+                    != std::filesystem::perms::none)
+                { names.insert(iterator->path().filename().string()); }
+            }
+            return names;
+        }
+    };
+
+    // Лексические классы слов.
+    enum class Class
+    {
+        Word     = 0,
+        Operator = 1,
+        String   = 2,
+        Variable = 3,
+        Modifier = 4,
+    };
+
+    // Слово строки ввода.
+    struct Token
+    {
+        size_t begin;
+        size_t end;
+        Class  lexical;
+    };
+
+    // Подсветка строки с инкрементальным разбором: при каждом обновлении заново разбирается
+    // только область между общими началом и концом старой и новой строк.
+    class Highlighter
+    {
+    public:
+        Highlighter(CommandIndex& init_index) : index(init_index) { }
+
+        // Раскрашенная строка.
+        std::string render(const std::string& new_line)
+        {
+            update(new_line);
+
+            std::string result;
+            result.reserve(line.size() * 2);
+            size_t position = 0;
+            bool has_command  = false; // Встречено ли имя команды в текущей стадии конвейера.
+            bool file_position = false; // Ожидается имя файла после перенаправления.
+            for (size_t k = 0; k < tokens.size(); ++k)
+            {
+                const Token& token = tokens[k];
+                result.append(line, position, token.begin - position);
+
+                std::string text = line.substr(token.begin, token.end - token.begin);
+                const std::string* color = &plain;
+                switch (token.lexical)
+                {
+                    case Class::Operator:
+                    {
+                        color = &operator_color;
+                        // После "|", ";", "&", "&&" и "||" начинается новая команда.
+                        if ((text != "<") && (text != ">") && (text.compare(0, 2, "<<") != 0)) { has_command = false; }
+                        // После отдельно стоящего перенаправления следует имя файла, ограничитель или строка.
+                        file_position = (text == "<") || (text == ">") || (text == "<<") || (text == "<<<");
+                        break;
+                    }
+                    case Class::Modifier:
+                    {
+                        if (!has_command) { color = &modifier_color; }
+                        break;
+                    }
+                    case Class::String:
+                    case Class::Variable:
+                    {
+                        color = (token.lexical == Class::String) ? &string_color : &variable_color;
+                        if (file_position) { file_position = false; }
+                        else { has_command = true; }
+                        break;
+                    }
+                    case Class::Word:
+                    {
+                        if (file_position) { file_position = false; }
+                        else if (!has_command)
+                        {
+                            color = index.exists(text) ? &command_color : &unknown_color;
+                            // После "time" в начале команды и после "memo" снова ожидается команда.
+                            bool first = (k == 0) || (tokens[k - 1].lexical == Class::Operator);
+                            has_command = !((first && (text == "time")) || (text == "memo"));
+                        }
+                        break;
+                    }
+                }
+
+                result += *color;
+                result += text;
+                result += plain;
+                position = token.end;
+            }
+            result.append(line, position, std::string::npos);
+            return result;
+        }
+
+    protected:
+        CommandIndex& index;
+
+        std::string line;           // Последняя разобранная строка.
+        std::vector<Token> tokens;  // Её слова.
+
+        // Цвета.
+        std::string plain          = ANSI::Modifier().string();
+        std::string command_color  = ANSI::Modifier(ANSI::Style::Bold,  ANSI::Color::Foreground::Green).string();
+        std::string unknown_color  = ANSI::Modifier(ANSI::Style::Bold,  ANSI::Color::Foreground::Red).string();
+        std::string operator_color = ANSI::Modifier(ANSI::Style::Bold,  ANSI::Color::Foreground::Yellow).string();
+        std::string string_color   = ANSI::Modifier(ANSI::Style::Reset, ANSI::Color::Foreground::Cyan).string();
+        std::string variable_color = ANSI::Modifier(ANSI::Style::Reset, ANSI::Color::Foreground::Magenta).string();
+        std::string modifier_color = ANSI::Modifier(ANSI::Style::Reset, ANSI::Color::Foreground::Blue).string();
+
+        // Является ли слово оператором. Here-документ и here-строка могут быть записаны слитно с операндом.
+        static bool is_operator(const std::string& text, size_t begin, size_t end)
+        {
+            size_t length = end - begin;
+            if ((length >= 2) && (text.compare(begin, 2, "<<") == 0)) { return true; }
+            if (length == 2) { return (text.compare(begin, 2, "&&") == 0) || (text.compare(begin, 2, "||") == 0); }
+            return (length == 1) && ((text[begin] == '|') || (text[begin] == '<') || (text[begin] == '>') || (text[begin] == ';') || (text[begin] == '&'));
+        }
+
+        // Разбор одного слова, начиная с позиции вне слова. Возвращает false, если слов больше нет.
+        // Разбиение совпадает с разбором введённой строки в main: пробелы вне двойных кавычек разделяют слова.
+        static bool lex(const std::string& text, size_t& position, Token& token)
+        {
+            while ((position < text.size()) && ((text[position] == ' ') || (text[position] == '\t'))) { ++position; }
+            if (position >= text.size()) { return false; }
+
+            token.begin = position;
+            bool quoted = false;
+            bool has_quotes = false;
+            for (; position < text.size(); ++position)
+            {
+                char c = text[position];
+                if (c == '\"') { quoted = !quoted; has_quotes = true; }
+                else if (!quoted && ((c == ' ') || (c == '\t'))) { break; }
+            }
+            token.end = position;
+
+            if (is_operator(text, token.begin, token.end)) { token.lexical = Class::Operator; }
+            else if (text[token.begin] == '$')             { token.lexical = Class::Variable; }
+            else if (has_quotes)                           { token.lexical = Class::String;   }
+            else if (text[token.begin] == '@')             { token.lexical = Class::Modifier; }
+            else                                           { token.lexical = Class::Word;     }
+            return true;
+        }
+
+        // Обновление разбора под новую строку.
+        void update(const std::string& new_line)
+        {
+            if (new_line == line) { return; }
+
+            // Границы изменённой области: общие начало и конец старой и новой строк.
+            size_t limit = std::min(line.size(), new_line.size());
+            size_t prefix = 0;
+            while ((prefix < limit) && (line[prefix] == new_line[prefix])) { ++prefix; }
+            size_t suffix = 0;
+            while ((suffix < limit - prefix) && (line[line.size() - 1 - suffix] == new_line[new_line.size() - 1 - suffix])) { ++suffix; }
+            const long delta = static_cast<long>(new_line.size()) - static_cast<long>(line.size());
+
+            // Первое слово, которого могло коснуться изменение. Разбор начинается с конца предыдущего слова,
+            // где разборщик гарантированно находится вне слова и вне кавычек.
+            size_t first = 0;
+            while ((first < tokens.size()) && (tokens[first].end < prefix)) { ++first; }
+            size_t position = (first > 0) ? tokens[first - 1].end : 0;
+
+            std::vector<Token> updated(tokens.begin(), tokens.begin() + first);
+            size_t old_next = first; // Первое старое слово, ещё не оказавшееся позади разбора.
+            Token token;
+            while (lex(new_line, position, token))
+            {
+                updated.push_back(token);
+
+                // Синхронизация: если слово закончилось в неизменённом конце строки там же, где и старое,
+                // дальнейший разбор совпадёт со старым и остальные слова переиспользуются со сдвигом.
+                if (token.end >= new_line.size() - suffix)
+                {
+                    size_t old_end = static_cast<size_t>(static_cast<long>(token.end) - delta);
+                    while ((old_next < tokens.size()) && (tokens[old_next].end < old_end)) { ++old_next; }
+                    if ((old_next < tokens.size()) && (tokens[old_next].end == old_end))
+                    {
+                        for (size_t k = old_next + 1; k < tokens.size(); ++k)
+                        {
+                            Token shifted = tokens[k];
+                            shifted.begin = static_cast<size_t>(static_cast<long>(shifted.begin) + delta);
+                            shifted.end   = static_cast<size_t>(static_cast<long>(shifted.end) + delta);
+                            updated.push_back(shifted);
+                        }
+                        break;
+                    }
+                }
+            }
+
+            tokens.swap(updated);
+            line = new_line;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,590 @@
+#ifndef HISTORY_SEARCH_HPP
+#define HISTORY_SEARCH_HPP
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HISTORY_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+// Инкрементальный нечёткий поиск по истории команд (Ctrl + R).
+// История хранится одним непрерывным буфером, записи разделены символом '\n'.
+// Кандидаты отбираются векторным поиском самого редкого символа запроса (AVX2, SSE2 или скалярно),
+// точный поиск (запрос начинается с "'") - векторным поиском подстроки (SSE4.2 или скалярно).
+// Если опорный символ встречается почти в каждой записи, записи перебираются от новых к старым с отсевом по маскам символов,
+// а короткие записи оцениваются по битовым маскам позиций символов запроса. Запись, которая по своей длине
+// не может обойти худшую из лучших, не оценивается; когда этого не может ни одна запись, просмотр прекращается.
+// Запросы из одного-двух символов подходят почти ко всему, поэтому для них, как только набраны лучшие результаты,
+// просматриваются только недавние записи.
+namespace HistorySearch
+{
+    // Векторные ядра поиска. Ядра поиска возвращают позицию найденного или size, если ничего не найдено.
+    namespace Kernels
+    {
+        // Скалярный поиск байта.
+        inline size_t find_byte_scalar(const char* data, size_t size, char c)
+        {
+            const void* found = memchr(data, c, size);
+            return found ? static_cast<size_t>(static_cast<const char*>(found) - data) : size;
+        }
+
+        // Скалярный поиск подстроки.
+        inline size_t find_substring_scalar(const char* data, size_t size, const char* needle, size_t length)
+        {
+            if (length == 0) { return 0; }
+            if (length > size) { return size; }
+            const char* end = data + size - length + 1;
+            for (const char* position = data; position < end; ++position)
+            {
+                position = static_cast<const char*>(memchr(position, needle[0], end - position));
+                if (position == nullptr) { break; }
+                if (memcmp(position, needle, length) == 0) { return position - data; }
+            }
+            return size;
+        }
+
+        #ifdef HISTORY_SEARCH_X86
+        // Поиск байта по 16 байт за итерацию (SSE2 есть на любом x86_64).
+        __attribute__((target("sse2")))
+        inline size_t find_byte_sse2(const char* data, size_t size, char c)
+        {
+            const __m128i pattern = _mm_set1_epi8(c);
+            size_t position = 0;
+            for (; position + 16 <= size; position += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+                if (mask) { return position + __builtin_ctz(mask); }
+            }
+            return position + find_byte_scalar(data + position, size - position, c);
+        }
+
+        // Поиск байта по 32 байта за итерацию.
+        __attribute__((target("avx2")))
+        inline size_t find_byte_avx2(const char* data, size_t size, char c)
+        {
+            const __m256i pattern = _mm256_set1_epi8(c);
+            size_t position = 0;
+            for (; position + 32 <= size; position += 32)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern)));
+                if (mask) { return position + __builtin_ctz(mask); }
+            }
+            return position + find_byte_scalar(data + position, size - position, c);
+        }
+
+        // Поиск подстроки инструкцией PCMPESTRI: за итерацию проверяются 16 возможных начал вхождения.
+        __attribute__((target("sse4.2")))
+        inline size_t find_substring_sse42(const char* data, size_t size, const char* needle, size_t length)
+        {
+            if (length == 0) { return 0; }
+            if (length > size) { return size; }
+
+            // В регистр помещаются первые 16 байт образца, остаток проверяется memcmp.
+            char head[16] = {0};
+            const int head_length = static_cast<int>(std::min<size_t>(length, 16));
+            memcpy(head, needle, head_length);
+            const __m128i pattern = _mm_loadu_si128(reinterpret_cast<const __m128i*>(head));
+
+            size_t position = 0;
+            while (position + 16 <= size)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+                int index = _mm_cmpestri(pattern, head_length, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ORDERED);
+                if (index == 16) { position += 16; continue; }
+
+                // Возможное вхождение (в том числе частичное на границе блока).
+                size_t start = position + index;
+                if (start + length > size) { return size; }
+                if (memcmp(data + start, needle, length) == 0) { return start; }
+                position = start + 1;
+            }
+            size_t rest = find_substring_scalar(data + position, size - position, needle, length);
+            return (rest == size - position) ? size : position + rest;
+        }
+        #endif
+
+        // Маски позиций каждого из символов chars среди первых size < 64 байт data.
+        inline void positions_scalar(const char* data, size_t size, const char* chars, size_t count, uint64_t* masks)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                masks[j] = 0;
+                for (size_t i = 0; i < size; ++i) { masks[j] |= uint64_t(data[i] == chars[j]) << i; }
+            }
+        }
+
+        #ifdef HISTORY_SEARCH_X86
+        // То же по 16 байт за сравнение: четыре блока записи загружаются один раз для всех символов.
+        // Читает 64 байта независимо от size.
+        __attribute__((target("sse2")))
+        inline void positions_sse2(const char* data, size_t size, const char* chars, size_t count, uint64_t* masks)
+        {
+            const uint64_t valid = (uint64_t(1) << size) - 1;
+            const __m128i block0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            const __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+            const __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+            const __m128i block3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+            for (size_t j = 0; j < count; ++j)
+            {
+                const __m128i pattern = _mm_set1_epi8(chars[j]);
+                uint64_t mask = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block0, pattern)));
+                mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block1, pattern)))) << 16;
+                mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block2, pattern)))) << 32;
+                mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block3, pattern)))) << 48;
+                masks[j] = mask & valid;
+            }
+        }
+        #endif
+
+        // Выбор реализации в зависимости от возможностей процессора. Выполняется один раз на поиск,
+        // а не на каждый вызов ядра.
+        using FindByte = size_t (*)(const char* data, size_t size, char c);
+        inline FindByte select_find_byte()
+        {
+            #ifdef HISTORY_SEARCH_X86
+            return __builtin_cpu_supports("avx2") ? find_byte_avx2 : find_byte_sse2;
+            #else
+            return find_byte_scalar;
+            #endif
+        }
+
+        using FindSubstring = size_t (*)(const char* data, size_t size, const char* needle, size_t length);
+        inline FindSubstring select_find_substring()
+        {
+            #ifdef HISTORY_SEARCH_X86
+            if (__builtin_cpu_supports("sse4.2")) { return find_substring_sse42; }
+            #endif
+            return find_substring_scalar;
+        }
+    }
+
+    // Приведение ASCII-символа к нижнему регистру (байты UTF-8 не изменяются).
+    inline char fold(char c) { return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c - 'A' + 'a') : c; }
+
+    // Является ли символ разделителем слов: ' ', '\t', '/', '-', '_', '.', '|', '='.
+    // Проверка по битовой маске вместо ветвлений.
+    inline bool separator(char character)
+    {
+        constexpr uint64_t low  = (uint64_t(1) << ' ') | (uint64_t(1) << '\t') | (uint64_t(1) << '/') | (uint64_t(1) << '-') |
+                                  (uint64_t(1) << '.') | (uint64_t(1) << '=');
+        constexpr uint64_t high = (uint64_t(1) << ('_' - 64)) | (uint64_t(1) << ('|' - 64));
+        unsigned char c = static_cast<unsigned char>(character);
+        return (c < 64) ? ((low >> c) & 1) : ((c < 128) && ((high >> (c - 64)) & 1));
+    }
+
+    // Является ли позиция началом слова.
+    inline bool boundary(const char* entry, size_t position)
+    {
+        return (position == 0) || separator(entry[position - 1]);
+    }
+
+    // Бит байта в маске символов записи: у букв и цифр собственные биты, остальные байты делят два.
+    // Маска допускает ложные срабатывания, но не пропуски.
+    inline uint64_t character_bit(char c)
+    {
+        unsigned bit = 62 + (static_cast<unsigned char>(c) & 1);
+        if      ((c >= 'a') && (c <= 'z')) { bit = c - 'a'; }
+        else if ((c >= 'A') && (c <= 'Z')) { bit = 26 + (c - 'A'); }
+        else if ((c >= '0') && (c <= '9')) { bit = 52 + (c - '0'); }
+        return uint64_t(1) << bit;
+    }
+
+    // Подсчёт очков окна [begin, end], в котором жадно от begin найдена подпоследовательность запроса:
+    // каждый символ запроса - 16, подряд идущий - ещё 8, в начале слова - ещё 8, каждый пропущенный символ окна - минус 1.
+    // Более короткие записи при равных совпадениях предпочтительнее.
+    inline long window_score(long matched_score, size_t begin, size_t end, size_t length, size_t size)
+    {
+        long score = matched_score - static_cast<long>(end - begin + 1 - length);
+        return std::max(1l, score * 4 - static_cast<long>(size / 16));
+    }
+
+    // Оценка нечёткого совпадения в духе fzf (v1): прямой проход находит конец первого вхождения подпоследовательности,
+    // обратный - самое короткое окно, оканчивающееся там же. Возвращает -1, если совпадения нет.
+    inline long fuzzy_score(const char* entry, size_t size, const std::string& query, Kernels::FindByte find_byte)
+    {
+        if (query.empty()) { return 0; }
+
+        // Прямой проход: каждый следующий символ запроса ищется векторным поиском байта.
+        size_t end = 0;
+        for (size_t matched = 0; matched < query.size(); ++matched, ++end)
+        {
+            end += find_byte(entry + end, size - end, query[matched]);
+            if (end >= size) { return -1; }
+        }
+        --end;
+
+        // Обратный проход.
+        size_t begin = end;
+        for (size_t j = query.size(); ; --begin)
+        {
+            if ((entry[begin] == query[j - 1]) && (--j == 0)) { break; }
+        }
+
+        // Очки за совпавшие символы.
+        long score = 0;
+        size_t previous = begin;
+        size_t j = 0;
+        for (size_t position = begin; j < query.size(); ++position)
+        {
+            if (entry[position] != query[j]) { continue; }
+            score += 16 + (boundary(entry, position) ? 8 : 0) + (((j > 0) && (position == previous + 1)) ? 8 : 0);
+            previous = position;
+            ++j;
+        }
+        return window_score(score, begin, end, query.size(), size);
+    }
+
+    // Наибольшая длина записи и запроса для оценки по битовым маскам.
+    constexpr size_t short_entry = 64;
+    constexpr size_t short_query = 16;
+
+    // Та же оценка для записи короче short_entry и запроса не длиннее short_query без посимвольных циклов:
+    // для каждого символа запроса строится маска его позиций в записи, а оба прохода и подсчёт очков
+    // сводятся к поиску младшего и старшего бита. padded - за записью доступны для чтения ещё short_entry байт.
+    inline long fuzzy_score_short(const char* entry, size_t size, const std::string& query, bool padded)
+    {
+        const size_t length = query.size();
+        if (length == 0) { return 0; }
+
+        uint64_t positions[short_query];
+        #ifdef HISTORY_SEARCH_X86
+        if (padded) { Kernels::positions_sse2(entry, size, query.data(), length, positions); }
+        else { Kernels::positions_scalar(entry, size, query.data(), length, positions); }
+        #else
+        (void)padded;
+        Kernels::positions_scalar(entry, size, query.data(), length, positions);
+        #endif
+
+        // Прямой проход: каждый следующий символ - младшая позиция после предыдущего.
+        uint64_t after = ~uint64_t(0);
+        size_t end = 0;
+        for (size_t j = 0; j < length; ++j)
+        {
+            uint64_t candidates = positions[j] & after;
+            if (candidates == 0) { return -1; }
+            end = __builtin_ctzll(candidates);
+            after = (end == 63) ? 0 : (~uint64_t(0) << (end + 1));
+        }
+
+        // Обратный проход: каждый предыдущий символ - старшая позиция до следующего.
+        size_t begin = end;
+        for (size_t j = length - 1; j > 0; --j)
+        {
+            begin = 63 - __builtin_clzll(positions[j - 1] & ((uint64_t(1) << begin) - 1));
+        }
+
+        // Очки за совпавшие символы: жадный проход от начала окна.
+        long score = 0;
+        after = ~uint64_t(0) << begin;
+        size_t previous = begin;
+        for (size_t j = 0; j < length; ++j)
+        {
+            size_t position = __builtin_ctzll(positions[j] & after);
+            score += 16 + (boundary(entry, position) ? 8 : 0) + (((j > 0) && (position == previous + 1)) ? 8 : 0);
+            previous = position;
+            after = (position == 63) ? 0 : (~uint64_t(0) << (position + 1));
+        }
+        return window_score(score, begin, end, length, size);
+    }
+
+    // Оценка точного совпадения подстроки. Возвращает -1, если совпадения нет.
+    inline long exact_score(const char* entry, size_t size, const std::string& needle, Kernels::FindSubstring find_substring)
+    {
+        size_t position = find_substring(entry, size, needle.data(), needle.size());
+        if (position == size && !needle.empty()) { return -1; }
+        long score = 24 * static_cast<long>(needle.size()) + (boundary(entry, position) ? 8 : 0);
+        return std::max(1l, score * 4 - static_cast<long>(size / 16));
+    }
+
+    // Упакованная копия истории с поиском.
+    class Index
+    {
+    public:
+        // Максимальное число ранжированных результатов, между которыми можно переключаться.
+        static constexpr size_t max_results = 128;
+
+        // Запросы не длиннее broad_query символов ищутся только среди recent_entries новейших записей,
+        // если там нашлось max_results подходящих.
+        static constexpr size_t broad_query = 2;
+        static constexpr size_t recent_entries = 16384;
+
+        // Добавление записи в конец истории.
+        void add(const std::string& entry)
+        {
+            begins.push_back(text.size());
+            uint64_t mask = 0;
+            uint64_t folded_mask = 0;
+            for (char c : entry)
+            {
+                text.push_back(c);
+                folded.push_back(fold(c));
+                ++counts[static_cast<unsigned char>(c)];
+                ++folded_counts[static_cast<unsigned char>(fold(c))];
+                mask |= character_bit(c);
+                folded_mask |= character_bit(fold(c));
+            }
+            masks.push_back(mask);
+            folded_masks.push_back(folded_mask);
+            text.push_back('\n');
+            folded.push_back('\n');
+        }
+
+        size_t size() const { return begins.size(); }
+
+        // Текст записи.
+        std::string entry(size_t index) const
+        {
+            return text.substr(begins[index], entry_end(index) - begins[index]);
+        }
+
+        // Обновление результатов для нового запроса.
+        // Если новый запрос продолжает предыдущий, перепроверяются только прежние кандидаты.
+        void search(const std::string& new_query)
+        {
+            bool refine = !query.empty() && (new_query.size() > query.size()) && (new_query.compare(0, query.size(), query) == 0);
+            query = new_query;
+            find_byte = Kernels::select_find_byte();
+            find_substring = Kernels::select_find_substring();
+
+            // Разбор запроса: "'" в начале - точный поиск; заглавные буквы включают учёт регистра.
+            exact = !query.empty() && (query[0] == '\'');
+            pattern = exact ? query.substr(1) : query;
+            case_sensitive = std::any_of(pattern.begin(), pattern.end(), [](char c) { return (c >= 'A') && (c <= 'Z'); });
+
+            // Наибольшие очки совпадения до штрафов: см. fuzzy_score и exact_score. Бонусы за начало слова и за символ
+            // подряд достаются одному символу запроса вместе, только если предыдущий символ запроса - разделитель.
+            ceiling = 0;
+            if (exact) { ceiling = 24 * static_cast<long>(pattern.size()) + 8; }
+            else
+            {
+                for (size_t j = 0; j < pattern.size(); ++j)
+                { ceiling += (j == 0) ? 24 : ((separator(pattern[j - 1])) ? 32 : 24); }
+            }
+
+            top.clear();
+            if (refine) { refilter(); }
+            else { scan(); }
+            rank();
+        }
+
+        // Ранжированные результаты (номера записей).
+        const std::vector<size_t>& results() const { return ranked; }
+
+    protected:
+        std::string text;            // Записи истории, разделённые '\n'.
+        std::string folded;          // То же в нижнем регистре.
+        std::vector<size_t> begins;  // Начала записей.
+        std::vector<uint64_t> masks;        // Маски символов записей.
+        std::vector<uint64_t> folded_masks; // То же для записей в нижнем регистре.
+        size_t counts[256]        = {0};  // Частоты байтов в text.
+        size_t folded_counts[256] = {0};  // Частоты байтов в folded.
+
+        std::string query;           // Текущий запрос.
+        std::string pattern;         // Запрос без признака точного поиска.
+        bool exact          = false;
+        bool case_sensitive = false;
+        Kernels::FindByte find_byte = Kernels::find_byte_scalar;                // Ядра, выбранные для текущего поиска.
+        Kernels::FindSubstring find_substring = Kernels::find_substring_scalar;
+
+        long ceiling = 0;            // Наибольшие очки совпадения с запросом до штрафов.
+
+        // Кандидаты для уточнения запроса, от новых записей к старым: подходящие записи и записи, пропущенные
+        // без оценки. Записи с номерами меньше unscanned ещё не просмотрены и тоже остаются кандидатами.
+        std::vector<size_t> candidates;
+        size_t unscanned = 0;
+        std::vector<std::pair<long, size_t>> top; // Куча лучших кандидатов, худший - в вершине.
+        std::vector<size_t> ranked;               // Лучшие записи по убыванию оценки.
+
+        size_t entry_end(size_t index) const
+        {
+            return ((index + 1 < begins.size()) ? begins[index + 1] : text.size()) - 1;
+        }
+
+        long score(size_t index) const
+        {
+            const std::string& haystack = case_sensitive ? text : folded;
+            const char* entry = haystack.data() + begins[index];
+            size_t length = entry_end(index) - begins[index];
+            if (pattern.empty()) { return 0; }
+            if (exact) { return exact_score(entry, length, pattern, find_substring); }
+            if ((length < short_entry) && (pattern.size() <= short_query))
+            { return fuzzy_score_short(entry, length, pattern, begins[index] + short_entry <= haystack.size()); }
+            return fuzzy_score(entry, length, pattern, find_byte);
+        }
+
+        // Порядок результатов: по убыванию оценки, при равенстве - более свежие.
+        static bool better(const std::pair<long, size_t>& a, const std::pair<long, size_t>& b)
+        {
+            return (a.first != b.first) ? (a.first > b.first) : (a.second > b.second);
+        }
+
+        // Наибольшая возможная оценка записи длины size: все символы запроса подряд в начале слов.
+        long bound(size_t size) const
+        {
+            if (pattern.empty()) { return 0; }
+            return std::max(1l, ceiling * 4 - static_cast<long>(size / 16));
+        }
+
+        // Добавление записи в кучу лучших max_results: большинство отсекается одним сравнением с худшим из них.
+        void offer(long value, size_t index)
+        {
+            const std::pair<long, size_t> candidate(value, index);
+            if (top.size() < max_results)
+            {
+                top.push_back(candidate);
+                std::push_heap(top.begin(), top.end(), better);
+            }
+            else if (better(candidate, top.front()))
+            {
+                std::pop_heap(top.begin(), top.end(), better);
+                top.back() = candidate;
+                std::push_heap(top.begin(), top.end(), better);
+            }
+        }
+
+        // Итог рассмотрения записи.
+        enum class Verdict
+        {
+            Drop = 0, // Не подходит под запрос.
+            Keep = 1, // Остаётся кандидатом.
+            Stop = 2, // Более старые записи не рассматриваются: просмотр окончен.
+        };
+
+        // Рассмотрение записи при просмотре от новых к старым. При равной оценке более старая запись
+        // не обходит уже найденные, поэтому запись, чья наибольшая возможная оценка не выше худшей из лучших,
+        // не оценивается.
+        Verdict examine(size_t index, uint64_t required, const std::vector<uint64_t>& entry_masks)
+        {
+            const bool full = (top.size() == max_results);
+            if (full && (bound(0) <= top.front().first)) { return Verdict::Stop; }
+            if (full && (pattern.size() <= broad_query) && (index + recent_entries < begins.size())) { return Verdict::Stop; }
+            if ((entry_masks[index] & required) != required) { return Verdict::Drop; }
+            if (full && (bound(entry_end(index) - begins[index]) <= top.front().first)) { return Verdict::Keep; }
+            long value = score(index);
+            if (value < 0) { return Verdict::Drop; }
+            offer(value, index);
+            return Verdict::Keep;
+        }
+
+        // Маска символов, обязательных для совпадения.
+        uint64_t required_mask() const
+        {
+            uint64_t required = 0;
+            for (char c : pattern) { required |= character_bit(c); }
+            return required;
+        }
+
+        // Просмотр ещё не просмотренных записей от новых к старым.
+        void scan_unscanned()
+        {
+            const std::vector<uint64_t>& entry_masks = case_sensitive ? masks : folded_masks;
+            const uint64_t required = required_mask();
+            while (unscanned > 0)
+            {
+                Verdict verdict = examine(unscanned - 1, required, entry_masks);
+                if (verdict == Verdict::Stop) { return; }
+                if (verdict == Verdict::Keep) { candidates.push_back(unscanned - 1); }
+                --unscanned;
+            }
+        }
+
+        // Полный просмотр буфера.
+        void scan()
+        {
+            candidates.clear();
+            unscanned = begins.size();
+            if (pattern.empty())
+            {
+                scan_unscanned();
+                return;
+            }
+
+            const std::string& haystack = case_sensitive ? text : folded;
+            const size_t* frequencies = case_sensitive ? counts : folded_counts;
+
+            // Векторный поиск опорного образца: подстроки при точном поиске, иначе самого редкого символа запроса.
+            // Каждое вхождение указывает на запись-кандидата, которая затем проверяется полностью.
+            char rarest = pattern[0];
+            for (char c : pattern)
+            { if (frequencies[static_cast<unsigned char>(c)] < frequencies[static_cast<unsigned char>(rarest)]) { rarest = c; } }
+
+            // Частый опорный символ встречается почти в каждой записи: векторный поиск по буферу вырождается
+            // в перебор записей с лишним поиском записи по позиции. Тогда записи перебираются подряд,
+            // а отсеиваются по маскам символов без обращения к тексту.
+            if (frequencies[static_cast<unsigned char>(rarest)] > begins.size() / 8)
+            {
+                scan_unscanned();
+                return;
+            }
+
+            const char* data = haystack.data();
+            size_t size = haystack.size();
+            size_t position = 0;
+            size_t index = 0;
+            while (position < size)
+            {
+                size_t found = exact ? find_substring(data + position, size - position, pattern.data(), pattern.size())
+                                     : find_byte(data + position, size - position, rarest);
+                if (found == size - position) { break; }
+                position += found;
+
+                // Запись, содержащая найденную позицию: экспоненциальный поиск от предыдущей записи,
+                // поскольку при частых вхождениях она обычно ближайшая.
+                size_t step = 1;
+                while ((index + step < begins.size()) && (begins[index + step] <= position)) { index += step; step *= 2; }
+                index = std::upper_bound(begins.begin() + index, begins.begin() + std::min(begins.size(), index + step), position) - begins.begin() - 1;
+                long value = score(index);
+                if (value >= 0)
+                {
+                    candidates.push_back(index);
+                    offer(value, index);
+                }
+
+                // Продолжение со следующей записи.
+                position = entry_end(index) + 1;
+            }
+
+            // Кандидаты хранятся от новых к старым.
+            std::reverse(candidates.begin(), candidates.end());
+            unscanned = 0;
+        }
+
+        // Перепроверка прежних кандидатов, затем ещё не просмотренных записей.
+        void refilter()
+        {
+            const std::vector<uint64_t>& entry_masks = case_sensitive ? masks : folded_masks;
+            const uint64_t required = required_mask();
+            size_t kept = 0;
+            for (size_t k = 0; k < candidates.size(); ++k)
+            {
+                Verdict verdict = examine(candidates[k], required, entry_masks);
+                if (verdict == Verdict::Stop)
+                {
+                    // Оставшиеся кандидаты и непросмотренные записи сохраняются для следующего уточнения.
+                    kept = std::copy(candidates.begin() + k, candidates.end(), candidates.begin() + kept) - candidates.begin();
+                    candidates.resize(kept);
+                    return;
+                }
+                if (verdict == Verdict::Keep) { candidates[kept++] = candidates[k]; }
+            }
+            candidates.resize(kept);
+            scan_unscanned();
+        }
+
+        // Упорядочение лучших результатов, накопленных в куче при просмотре.
+        void rank()
+        {
+            std::sort_heap(top.begin(), top.end(), better);
+            ranked.clear();
+            for (const std::pair<long, size_t>& candidate : top) { ranked.push_back(candidate.second); }
+        }
+    };
+}
+
+#endif
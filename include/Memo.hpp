@@ -0,0 +1,415 @@
+#ifndef MEMO_HPP
+#define MEMO_HPP
+#include <string>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <cerrno>
+
+// Linux.
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/sendfile.h>
+
+#include "FileDescriptor.hpp"
+
+// Кэш результатов детерминированных команд (встроенная команда memo).
+// Ключ записи - хэш аргументов, текущей директории, выбранных переменных среды, исполняемого файла,
+// файлов-аргументов и стандартного ввода, если он перенаправлен из файла.
+// Запись хранит код завершения и стандартный вывод команды.
+//
+// Настройка через переменные среды:
+//   MEMO_DIR   - каталог кэша (по умолчанию $XDG_CACHE_HOME/microsha/memo или ~/.cache/microsha/memo);
+//   MEMO_LIMIT - предельный объём кэша в байтах (по умолчанию 256 МиБ), лишнее вытесняется по давности использования;
+//   MEMO_ENV   - список имён переменных среды через запятую, входящих в ключ (PATH входит всегда);
+//   MEMO_HASH  - "content" для хэширования содержимого файлов вместо размера и времени изменения.
+namespace Memo
+{
+    // 128-битный хэш: две независимые ветви FNV-1a.
+    class Hash
+    {
+    public:
+        void update(const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                low  = (low  ^ bytes[i]) * 0x100000001b3ull;
+                high = (high ^ bytes[i]) * 0x100000001b3ull;
+                high ^= high >> 29;
+            }
+        }
+
+        // Строка хэшируется вместе с длиной, чтобы ("ab", "c") и ("a", "bc") различались.
+        void update(const std::string& string)
+        {
+            uint64_t size = string.size();
+            update(&size, sizeof(size));
+            update(string.data(), string.size());
+        }
+
+        std::string hex() const
+        {
+            char buffer[33];
+            snprintf(buffer, sizeof(buffer), "%016llx%016llx", static_cast<unsigned long long>(high), static_cast<unsigned long long>(low));
+            return buffer;
+        }
+
+    protected:
+        uint64_t low  = 0xcbf29ce484222325ull;
+        uint64_t high = 0x84222325cbf29ce4ull;
+    };
+
+    // Значение переменной среды или значение по умолчанию.
+    inline std::string environment(const char* name, const std::string& fallback = std::string())
+    {
+        const char* ptr = std::getenv(name);
+        return ((ptr == nullptr) || (*ptr == '\0')) ? fallback : std::string(ptr);
+    }
+
+    // Каталог кэша.
+    inline std::string directory()
+    {
+        std::string result = environment("MEMO_DIR");
+        if (!result.empty()) { return result; }
+        std::string cache = environment("XDG_CACHE_HOME", environment("HOME", "/tmp") + "/.cache");
+        return cache + "/microsha/memo";
+    }
+
+    // Предельный объём кэша.
+    inline uint64_t limit()
+    {
+        std::string value = environment("MEMO_LIMIT");
+        char* end = nullptr;
+        unsigned long long result = value.empty() ? 0 : std::strtoull(value.c_str(), &end, 10);
+        return ((result == 0) || (*end != '\0')) ? (256ull << 20) : result;
+    }
+
+    // Учёт файла в ключе: по содержимому или по размеру, времени изменения и индексному дескриптору.
+    inline void hash_file(Hash& hash, int fd, const struct stat& info, bool content)
+    {
+        if (!content)
+        {
+            int64_t fields[5] = { static_cast<int64_t>(info.st_dev), static_cast<int64_t>(info.st_ino), static_cast<int64_t>(info.st_size),
+                                  static_cast<int64_t>(info.st_mtim.tv_sec), static_cast<int64_t>(info.st_mtim.tv_nsec) };
+            hash.update(fields, sizeof(fields));
+            return;
+        }
+
+        // pread не сдвигает позицию чтения: стандартный ввод останется нетронутым для команды.
+        char buffer[1 << 16];
+        off_t offset = 0;
+        ssize_t count = 0;
+        while ((count = pread(fd, buffer, sizeof(buffer), offset)) > 0)
+        {
+            hash.update(buffer, count);
+            offset += count;
+        }
+    }
+
+    // Поиск исполняемого файла команды по PATH.
+    inline std::string resolve(const std::string& command)
+    {
+        if (command.find('/') != std::string::npos) { return command; }
+        std::string path = environment("PATH");
+        size_t position = 0;
+        while (position <= path.size())
+        {
+            size_t colon = path.find(':', position);
+            if (colon == std::string::npos) { colon = path.size(); }
+            std::string candidate = ((colon == position) ? std::string(".") : path.substr(position, colon - position)) + "/" + command;
+            if (access(candidate.c_str(), X_OK) == 0) { return candidate; }
+            position = colon + 1;
+        }
+        return command;
+    }
+
+    // Вычисление ключа. Возвращает false, если результат нельзя кэшировать (ввод из pipe'а).
+    inline bool key(const std::vector<std::string>& args, int input_fd, std::string& result)
+    {
+        const bool content = (environment("MEMO_HASH") == "content");
+        Hash hash;
+        hash.update(std::string("microsha-memo-1"));
+
+        // Аргументы и текущая директория.
+        for (const std::string& arg : args) { hash.update(arg); }
+        char* cwd = get_current_dir_name();
+        if (cwd != nullptr)
+        {
+            hash.update(std::string(cwd));
+            free(cwd);
+        }
+
+        // Переменные среды.
+        std::string names = "PATH," + environment("MEMO_ENV");
+        size_t position = 0;
+        while (position < names.size())
+        {
+            size_t comma = names.find_first_of(",:", position);
+            if (comma == std::string::npos) { comma = names.size(); }
+            std::string name = names.substr(position, comma - position);
+            position = comma + 1;
+            if (name.empty()) { continue; }
+            const char* value = std::getenv(name.c_str());
+            hash.update(name + (value ? "=" + std::string(value) : std::string()));
+        }
+
+        // Исполняемый файл и файлы-аргументы.
+        struct stat info;
+        std::string executable = resolve(args[0]);
+        if (stat(executable.c_str(), &info) == 0) { hash_file(hash, -1, info, false); }
+        for (size_t i = 1; i < args.size(); ++i)
+        {
+            if ((stat(args[i].c_str(), &info) != 0) || !S_ISREG(info.st_mode)) { continue; }
+            hash.update(args[i]);
+            int fd = content ? open(args[i].c_str(), O_RDONLY) : -1;
+            hash_file(hash, fd, info, content && (fd != -1));
+            if (fd != -1) { close(fd); }
+        }
+
+        // Стандартный ввод: файл учитывается, терминал не читается командой-генератором, pipe делает результат непредсказуемым.
+        if (fstat(input_fd, &info) == 0)
+        {
+            if (S_ISFIFO(info.st_mode) || S_ISSOCK(info.st_mode)) { return false; }
+            if (S_ISREG(info.st_mode))
+            {
+                hash.update(std::string("<stdin>"));
+                hash_file(hash, input_fd, info, content);
+            }
+        }
+
+        result = hash.hex();
+        return true;
+    }
+
+    // Каталог кэша с записями, счётчиками и вытеснением.
+    class Cache
+    {
+    public:
+        Cache() : path(directory())
+        {
+            std::error_code error;
+            std::filesystem::create_directories(path, error);
+        }
+
+        // Воспроизведение записи в output_fd через sendfile. Возвращает false при промахе.
+        bool replay(const std::string& key, int output_fd, int& status)
+        {
+            std::string entry = path + "/" + key;
+            int fd = open(entry.c_str(), O_RDONLY);
+            if (fd == -1) { return false; }
+
+            struct stat info;
+            Header header;
+            if ((fstat(fd, &info) != 0) || (pread(fd, &header, sizeof(header), 0) != sizeof(header)) || (memcmp(header.magic, "msh1", 4) != 0))
+            {
+                close(fd);
+                return false;
+            }
+            status = header.status;
+
+            // Обновление времени использования для вытеснения давно не использованных записей.
+            futimens(fd, nullptr);
+            count(0);
+
+            off_t offset = sizeof(header);
+            while (offset < info.st_size)
+            {
+                ssize_t sent = sendfile(output_fd, fd, &offset, info.st_size - offset);
+                if (sent > 0) { continue; }
+                if ((sent < 0) && (errno == EINTR)) { continue; }
+                if ((sent < 0) && ((errno == EINVAL) || (errno == ENOSYS)))
+                {
+                    // Старые ядра не умеют sendfile в этот тип файла.
+                    char buffer[1 << 16];
+                    ssize_t read_count = 0;
+                    while ((read_count = pread(fd, buffer, sizeof(buffer), offset)) > 0)
+                    {
+                        if (!write_all(output_fd, buffer, read_count)) { break; }
+                        offset += read_count;
+                    }
+                }
+                break;
+            }
+            close(fd);
+            return true;
+        }
+
+        // Начало записи нового результата во временный файл.
+        bool begin(const std::string& new_key)
+        {
+            key = new_key;
+            temporary = path + "/tmp." + std::to_string(getpid());
+            writer_fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (writer_fd == -1) { return false; }
+            written = 0;
+            maximum = limit();
+
+            Header header;
+            if (!write_all(writer_fd, reinterpret_cast<const char*>(&header), sizeof(header))) { abort(); }
+            count(1);
+            return writer_fd != -1;
+        }
+
+        // Дописывание вывода. Запись, которая не поместится в кэш целиком, отбрасывается сразу.
+        void write(const char* data, size_t size)
+        {
+            if (writer_fd == -1) { return; }
+            written += size;
+            if ((written > maximum) || !write_all(writer_fd, data, size)) { abort(); }
+        }
+
+        // Ведётся ли запись.
+        bool writing() const { return writer_fd != -1; }
+
+        // Завершение записи: код завершения в заголовок, атомарное переименование и вытеснение.
+        void commit(int status)
+        {
+            if (writer_fd == -1) { return; }
+            Header header;
+            header.status = status;
+            bool written = (pwrite(writer_fd, &header, sizeof(header), 0) == sizeof(header));
+            close(writer_fd);
+            writer_fd = -1;
+            if (!written || (rename(temporary.c_str(), (path + "/" + key).c_str()) != 0))
+            {
+                unlink(temporary.c_str());
+                return;
+            }
+            evict();
+        }
+
+        void abort()
+        {
+            if (writer_fd == -1) { return; }
+            close(writer_fd);
+            writer_fd = -1;
+            unlink(temporary.c_str());
+        }
+
+        // Вывод статистики кэша.
+        void stats(std::ostream& os)
+        {
+            uint64_t counters[3] = {0, 0, 0};
+            read_counters(counters);
+
+            uint64_t total = 0;
+            size_t entries = 0;
+            for (const Entry& entry : list()) { total += entry.size; ++entries; }
+
+            os << "Каталог:   " << path << std::endl
+               << "Записей:   " << entries << std::endl
+               << "Объём:     " << total << " из " << limit() << " байт" << std::endl
+               << "Попаданий: " << counters[0] << std::endl
+               << "Промахов:  " << counters[1] << std::endl
+               << "Вытеснено: " << counters[2] << std::endl;
+        }
+
+    protected:
+        // Заголовок записи.
+        struct Header
+        {
+            char    magic[4] = { 'm', 's', 'h', '1' };
+            int32_t status   = 0;
+        };
+
+        // Запись кэша на диске.
+        struct Entry
+        {
+            std::string path;
+            uint64_t size;
+            timespec used;
+        };
+
+        std::string path;
+        std::string key;
+        std::string temporary;
+        int writer_fd = -1;
+        uint64_t written = 0; // Объём записанного вывода.
+        uint64_t maximum = 0; // Предельный объём записи - объём всего кэша.
+
+        // Записи кэша. Забытые временные файлы (оборванная запись) старше часа удаляются.
+        std::vector<Entry> list()
+        {
+            std::vector<Entry> result;
+            std::error_code error;
+            const time_t now = ::time(nullptr);
+            for (auto iterator = std::filesystem::directory_iterator(path, error);
+                 !error && (iterator != std::filesystem::directory_iterator()); iterator.increment(error))
+            {
+                std::string name = iterator->path().filename().string();
+                struct stat info;
+                if (stat(iterator->path().c_str(), &info) != 0) { continue; }
+                if (name.compare(0, 4, "tmp.") == 0)
+                {
+                    if (now - info.st_mtime > 3600) { unlink(iterator->path().c_str()); }
+                    continue;
+                }
+                if ((name.size() != 32) || !S_ISREG(info.st_mode)) { continue; }
+                result.push_back(Entry{ iterator->path().string(), static_cast<uint64_t>(info.st_size), info.st_mtim });
+            }
+            return result;
+        }
+
+        // Вытеснение давно не использованных записей сверх предельного объёма.
+        void evict()
+        {
+            std::vector<Entry> entries = list();
+            uint64_t total = 0;
+            for (const Entry& entry : entries) { total += entry.size; }
+
+            const uint64_t maximum = limit();
+            if (total <= maximum) { return; }
+
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+                      { return (a.used.tv_sec != b.used.tv_sec) ? (a.used.tv_sec < b.used.tv_sec) : (a.used.tv_nsec < b.used.tv_nsec); });
+            for (const Entry& entry : entries)
+            {
+                if (total <= maximum) { break; }
+                if (unlink(entry.path.c_str()) == 0)
+                {
+                    total -= entry.size;
+                    count(2);
+                }
+            }
+        }
+
+        // Счётчики попаданий, промахов и вытеснений хранятся в файле stats под блокировкой.
+        void read_counters(uint64_t counters[3])
+        {
+            FILE* file = fopen((path + "/stats").c_str(), "r");
+            if (file == nullptr) { return; }
+            unsigned long long values[3] = {0, 0, 0};
+            if (fscanf(file, "%llu %llu %llu", &values[0], &values[1], &values[2]) == 3)
+            { for (size_t i = 0; i < 3; ++i) { counters[i] = values[i]; } }
+            fclose(file);
+        }
+
+        void count(size_t index)
+        {
+            int fd = open((path + "/stats").c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd == -1) { return; }
+            flock(fd, LOCK_EX);
+
+            char buffer[128] = {0};
+            unsigned long long values[3] = {0, 0, 0};
+            if (pread(fd, buffer, sizeof(buffer) - 1, 0) > 0) { sscanf(buffer, "%llu %llu %llu", &values[0], &values[1], &values[2]); }
+            ++values[index];
+
+            int length = snprintf(buffer, sizeof(buffer), "%llu %llu %llu\n", values[0], values[1], values[2]);
+            if (ftruncate(fd, 0) == 0) { pwrite(fd, buffer, length, 0); }
+            flock(fd, LOCK_UN);
+            close(fd);
+        }
+    };
+}
+
+#endif
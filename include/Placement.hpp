@@ -0,0 +1,249 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdlib>
+
+// Linux.
+#include <sched.h>
+#include <sys/resource.h>
+
+// Размещение стадий конвейера: привязка к процессорам, nice и политика планирования.
+// Модификаторы записываются перед командой стадии:
+//   @cpu=0-3,6      - явный список процессоров;
+//   @cpu=auto       - автоматическое размещение по общим кэшам L2/LLC;
+//   @nice=N         - значение nice;
+//   @sched=P[:PRIO] - политика планирования (other, batch, idle, fifo, rr) и приоритет.
+namespace Placement
+{
+    // Параметры размещения одной стадии.
+    struct StageOptions
+    {
+        bool affinity      = false; // Задан ли явный список процессоров.
+        bool auto_affinity = false; // Запрошено ли автоматическое размещение.
+        cpu_set_t cpus;             // Список процессоров.
+
+        bool nice_set = false;
+        int  nice     = 0;
+
+        bool policy_set = false;
+        int  policy     = SCHED_OTHER;
+        int  priority   = 0;
+
+        StageOptions() { CPU_ZERO(&cpus); }
+    };
+
+    // Разбор целого числа со знаком. Возвращает false, если строка не является числом целиком.
+    inline bool parse_int(const std::string& string, int& value)
+    {
+        if (string.empty()) { return false; }
+        char* end = nullptr;
+        long result = std::strtol(string.c_str(), &end, 10);
+        if (*end != '\0') { return false; }
+        value = static_cast<int>(result);
+        return true;
+    }
+
+    // Разбор списка процессоров в формате ядра ("0-3,6,8-9").
+    inline bool parse_cpu_list(const std::string& list, cpu_set_t& set)
+    {
+        CPU_ZERO(&set);
+        size_t position = 0;
+        while (position < list.size())
+        {
+            size_t comma = list.find(',', position);
+            if (comma == std::string::npos) { comma = list.size(); }
+            std::string range = list.substr(position, comma - position);
+            position = comma + 1;
+            if (range.empty()) { continue; }
+
+            int first = 0;
+            int last  = 0;
+            size_t dash = range.find('-');
+            if (dash == std::string::npos)
+            {
+                if (!parse_int(range, first)) { return false; }
+                last = first;
+            }
+            else if (!parse_int(range.substr(0, dash), first) || !parse_int(range.substr(dash + 1), last)) { return false; }
+
+            if ((first < 0) || (last < first) || (last >= CPU_SETSIZE)) { return false; }
+            for (int cpu = first; cpu <= last; ++cpu) { CPU_SET(cpu, &set); }
+        }
+        return CPU_COUNT(&set) > 0;
+    }
+
+    // Разбор модификатора стадии вида "@имя=значение".
+    inline bool parse_option(const std::string& word, StageOptions& options)
+    {
+        size_t delimeter_position = word.find('=');
+        if ((word.size() < 2) || (word[0] != '@') || (delimeter_position == std::string::npos)) { return false; }
+        std::string name  = word.substr(1, delimeter_position - 1);
+        std::string value = word.substr(delimeter_position + 1);
+
+        if (name == "cpu")
+        {
+            if (value == "auto")
+            {
+                options.auto_affinity = true;
+                options.affinity = false;
+                return true;
+            }
+            options.auto_affinity = false;
+            return (options.affinity = parse_cpu_list(value, options.cpus));
+        }
+        else if (name == "nice")
+        {
+            return (options.nice_set = parse_int(value, options.nice));
+        }
+        else if (name == "sched")
+        {
+            std::string policy = value;
+            options.priority = 0;
+            size_t colon = value.find(':');
+            if (colon != std::string::npos)
+            {
+                policy = value.substr(0, colon);
+                if (!parse_int(value.substr(colon + 1), options.priority)) { return false; }
+            }
+
+            if      (policy == "other") { options.policy = SCHED_OTHER; }
+            else if (policy == "batch") { options.policy = SCHED_BATCH; }
+            else if (policy == "idle")  { options.policy = SCHED_IDLE;  }
+            else if (policy == "fifo")  { options.policy = SCHED_FIFO;  }
+            else if (policy == "rr")    { options.policy = SCHED_RR;    }
+            else { return false; }
+
+            // Политики реального времени требуют ненулевого приоритета.
+            if (((options.policy == SCHED_FIFO) || (options.policy == SCHED_RR)) && (colon == std::string::npos)) { options.priority = 1; }
+            return (options.policy_set = true);
+        }
+        return false;
+    }
+
+    // Применение параметров к текущему процессу. Вызывается в дочернем процессе перед exec.
+    inline bool apply(const StageOptions& options)
+    {
+        if ((options.affinity || options.auto_affinity) && sched_setaffinity(0, sizeof(cpu_set_t), &options.cpus)) { return false; }
+        if (options.nice_set && setpriority(PRIO_PROCESS, 0, options.nice)) { return false; }
+        if (options.policy_set)
+        {
+            sched_param parameters;
+            parameters.sched_priority = options.priority;
+            if (sched_setscheduler(0, options.policy, &parameters)) { return false; }
+        }
+        return true;
+    }
+
+    // Топология кэшей: процессоры, сгруппированные по общему LLC, а внутри - по общему L2.
+    class Topology
+    {
+    public:
+        // Группы LLC, каждая из которых состоит из групп L2.
+        std::vector<std::vector<cpu_set_t>> groups;
+
+        // Топология читается из /sys один раз за время работы оболочки.
+        static const Topology& instance()
+        {
+            static Topology topology;
+            return topology;
+        }
+
+    protected:
+        Topology()
+        {
+            // Учитываются только процессоры, доступные самой оболочке (taskset, cgroup).
+            cpu_set_t allowed;
+            if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed)) { return; }
+
+            std::map<std::string, size_t> llc_index;               // Список процессоров LLC -> номер группы.
+            std::vector<std::map<std::string, size_t>> l2_index;   // Список процессоров L2 -> номер подгруппы.
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (!CPU_ISSET(cpu, &allowed)) { continue; }
+
+                std::string l2;
+                std::string llc;
+                read_caches(cpu, l2, llc);
+
+                // Нет сведений о кэшах - процессор образует собственную группу.
+                if (llc.empty()) { llc = std::to_string(cpu); }
+                if (l2.empty())  { l2  = std::to_string(cpu); }
+
+                auto llc_found = llc_index.find(llc);
+                if (llc_found == llc_index.end())
+                {
+                    llc_found = llc_index.emplace(llc, groups.size()).first;
+                    groups.emplace_back();
+                    l2_index.emplace_back();
+                }
+                std::vector<cpu_set_t>& group = groups[llc_found->second];
+                std::map<std::string, size_t>& subgroups = l2_index[llc_found->second];
+
+                auto l2_found = subgroups.find(l2);
+                if (l2_found == subgroups.end())
+                {
+                    l2_found = subgroups.emplace(l2, group.size()).first;
+                    group.emplace_back();
+                    CPU_ZERO(&group.back());
+                }
+                CPU_SET(cpu, &group[l2_found->second]);
+            }
+        }
+
+        // Чтение списков процессоров, разделяющих кэш L2 и кэш последнего уровня.
+        static void read_caches(int cpu, std::string& l2, std::string& llc)
+        {
+            const std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+            int llc_level = 0;
+            for (size_t index = 0; ; ++index)
+            {
+                std::ifstream level_file(base + std::to_string(index) + "/level");
+                if (!level_file) { break; }
+
+                int level = 0;
+                std::string type;
+                std::string shared;
+                level_file >> level;
+                std::ifstream(base + std::to_string(index) + "/type") >> type;
+                std::ifstream(base + std::to_string(index) + "/shared_cpu_list") >> shared;
+                if (type == "Instruction") { continue; }
+
+                if (level == 2) { l2 = shared; }
+                if (level >= llc_level) { llc_level = level; llc = shared; }
+            }
+        }
+    };
+
+    // Автоматическое размещение стадий одного конвейера.
+    // Все стадии конвейера попадают в одну группу LLC; соседние стадии занимают соседние группы L2.
+    // Последовательные конвейеры распределяются по группам LLC по кругу.
+    class AutoPlacer
+    {
+    public:
+        // Начало нового конвейера.
+        void begin_pipeline() { group = -1; }
+
+        // Процессоры для стадии с указанным номером. Возвращает false, если топология неизвестна.
+        bool place(size_t stage, cpu_set_t& cpus)
+        {
+            const Topology& topology = Topology::instance();
+            if (topology.groups.empty()) { return false; }
+
+            // Группа LLC выбирается при размещении первой стадии конвейера.
+            if (group == -1) { group = static_cast<long>(next_group++ % topology.groups.size()); }
+
+            const std::vector<cpu_set_t>& subgroups = topology.groups[group];
+            cpus = subgroups[stage % subgroups.size()];
+            return true;
+        }
+
+    protected:
+        long   group      = -1; // Группа LLC текущего конвейера.
+        size_t next_group = 0;  // Группа LLC для следующего конвейера.
+    };
+}
+
+#endif
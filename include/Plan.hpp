@@ -0,0 +1,414 @@
+#ifndef PLAN_HPP
+#define PLAN_HPP
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "Placement.hpp"
+#include "Builtins.hpp"
+
+// План выполнения строки: конвейеры, соединённые операторами ";", "&", "&&" и "||".
+// Строка разбирается один раз, план кэшируется по её тексту: каждый конвейер хранится уже разобранным на стадии
+// с командой, перенаправлениями, параметрами размещения и признаками memo и "+{}". При каждом запуске выполняются
+// только подстановка переменных и раскрытие шаблонов, так как их значения могут измениться между запусками.
+namespace Plan
+{
+    // Аргумент стадии.
+    struct Argument
+    {
+        enum class Kind
+        {
+            Literal  = 0, // Готовое значение.
+            Variable = 1, // Переменная ("$ИМЯ"), text - имя.
+            Glob     = 2, // Шаблон имён файлов.
+        };
+        Kind kind;
+        std::string text;      // Слово без двойных кавычек.
+        bool streamed = false; // Раскрывается потоком при запуске пачками (начиная с первого шаблона стадии).
+    };
+
+    // Перенаправление ввода стадии.
+    struct Input
+    {
+        enum class Kind
+        {
+            None         = 0,
+            File         = 1, // "< ФАЙЛ".
+            HereDocument = 2, // "<<ОГРАНИЧИТЕЛЬ": тело читается после ввода строки.
+            HereString   = 3, // "<<<СЛОВО".
+        };
+        Kind kind = Kind::None;
+        std::string path;      // Файл для "<".
+        Argument text;         // Содержимое here-строки (значение или переменная).
+        size_t heredoc = 0;    // Номер here-документа среди here-документов строки.
+    };
+
+    // Стадия конвейера.
+    struct Stage
+    {
+        std::string command;                       // Имя команды, передаётся неизменным.
+        const Builtins::Builtin* builtin = nullptr; // Встроенная команда с этим именем.
+        std::vector<Argument> arguments;           // Аргументы после имени команды.
+        Placement::StageOptions options;           // Параметры размещения ("@имя=значение" перед командой).
+        bool memoized = false;                     // "memo" перед командой.
+        bool batched = false;                      // "+{}" в конце стадии.
+        Input input;
+        std::string output;                        // Файл для "> ФАЙЛ" (пустая строка - без перенаправления).
+    };
+
+    // Команда, которую выполняет сама оболочка вместо конвейера.
+    enum class Control
+    {
+        None      = 0,
+        Exit      = 1, // exit
+        SetOption = 2, // set -o имя, set +o имя
+        MemoStats = 3, // memo stats
+    };
+
+    // Узел плана - один конвейер.
+    struct Node
+    {
+        std::vector<Stage> stages;
+        bool time = false;             // Конвейер предварён командой time.
+        Control control = Control::None;
+        std::string option;            // Имя параметра для set.
+        bool option_value = false;     // Включается (-o) или выключается (+o) параметр.
+        size_t on_success = 0;         // Следующий узел при нулевом коде завершения (размер списка - конец списка).
+        size_t on_failure = 0;         // Следующий узел при ненулевом коде завершения.
+    };
+
+    // Список конвейеров, соединённых "&&" и "||", до ";" или "&".
+    struct List
+    {
+        std::vector<Node> nodes;
+        bool background; // Список завершён "&": выполняется одновременно с последующими.
+    };
+
+    // План строки.
+    struct Plan
+    {
+        std::vector<List> lists;
+        std::vector<std::string> delimiters; // Ограничители here-документов строки по порядку.
+    };
+
+    // Разбиение ввода на слова с учётом символов ' " '.
+    inline std::vector<std::string> split(const std::string& input)
+    {
+        std::vector<std::string> words;
+
+        // Состояния ДКА.
+        enum class States
+        {
+            Whitespace = 0,
+            Quoted     = 1,
+            Unquoted   = 2,
+        };
+        States state = States::Whitespace;
+        for (size_t i = 0; i < input.size(); ++i)
+        {
+            switch (state)
+            {
+                case States::Whitespace:
+                {
+                    switch (input[i])
+                    {
+                        case ' ':  { break; }
+                        case '\t': { break; }
+                        case '\"':
+                        {
+                            state = States::Quoted;
+                            words.push_back(""); // Встретился непустой символ - создаётся новое слово.
+                            break;
+                        }
+                        default:
+                        {
+                            state = States::Unquoted;
+                            words.push_back(""); // Встретился непустой символ - создаётся новое слово.
+                            break;
+                        }
+                    }
+                    break;
+                }
+                case States::Quoted:
+                {
+                    switch (input[i])
+                    {
+                        case '\"': { state = States::Unquoted; break; }
+                        default:   { break; }
+                    }
+                    break;
+                }
+                case States::Unquoted:
+                {
+                    switch (input[i])
+                    {
+                        case ' ':  { state = States::Whitespace; break; }
+                        case '\t': { state = States::Whitespace; break; }
+                        case '\"': { state = States::Quoted; break; }
+                        default:   { break; }
+                    }
+                    break;
+                }
+            }
+
+            // Если символ не пустой, добавляем в слово.
+            if (state != States::Whitespace)
+            { words[words.size() - 1].push_back(input[i]); }
+        }
+
+        return words;
+    }
+
+    // Является ли слово оператором, разделяющим конвейеры.
+    inline bool is_separator(const std::string& word)
+    {
+        return (word == ";") || (word == "&") || (word == "&&") || (word == "||");
+    }
+
+    // Является ли слово шаблоном имён файлов.
+    inline bool is_glob(const std::string& word)
+    {
+        return word.find_first_of("*?[") != std::string::npos;
+    }
+
+    // Аргумент из слова: двойные кавычки удаляются, "$ИМЯ" без кавычек - переменная.
+    inline Argument make_argument(const std::string& word)
+    {
+        Argument argument{ Argument::Kind::Literal, std::string() };
+        for (char c : word) { if (c != '\"') { argument.text += c; } }
+        if (word[0] == '$')
+        {
+            argument.kind = Argument::Kind::Variable;
+            argument.text.erase(0, 1);
+        }
+        else if (is_glob(argument.text)) { argument.kind = Argument::Kind::Glob; }
+        return argument;
+    }
+
+    // Разбор конвейера words[begin, end) в узел. heredoc - номер первого here-документа конвейера.
+    // Возвращает false при неверной структуре.
+    inline bool compile_pipeline(const std::vector<std::string>& words, size_t begin, size_t end, size_t heredoc, Node& node)
+    {
+        // Команды самой оболочки.
+        if (words[begin] == "exit")
+        {
+            node.control = Control::Exit;
+            return true;
+        }
+        if ((words[begin] == "set") && (end - begin == 3) && ((words[begin + 1] == "-o") || (words[begin + 1] == "+o")))
+        {
+            node.control = Control::SetOption;
+            node.option = words[begin + 2];
+            node.option_value = (words[begin + 1] == "-o");
+            return true;
+        }
+        if ((words[begin] == "memo") && (end - begin == 2) && (words[begin + 1] == "stats"))
+        {
+            node.control = Control::MemoStats;
+            return true;
+        }
+
+        size_t i = begin;
+        if (words[i] == "time")
+        {
+            node.time = true;
+            ++i;
+        }
+
+        Stage stage;
+        bool batch_closed = false; // "+{}" уже встретилось: дальше допустимы только перенаправления.
+        for (; i < end; ++i)
+        {
+            const std::string& word = words[i];
+            if (word == "|")
+            {
+                // Вывод уже переопределён или нет команды.
+                if (!stage.output.empty() || stage.command.empty()) { return false; }
+                node.stages.push_back(std::move(stage));
+                stage = Stage();
+                batch_closed = false;
+            }
+            else if ((word == "<") || (word.compare(0, 2, "<<") == 0))
+            {
+                // Ввод уже переопределён, в том числе pipe'ом.
+                if ((stage.input.kind != Input::Kind::None) || !node.stages.empty()) { return false; }
+
+                if (word == "<")
+                {
+                    if (i + 1 >= end) { return false; }
+                    stage.input.kind = Input::Kind::File;
+                    stage.input.path = words[++i];
+                    continue;
+                }
+
+                // Here-документ или here-строка ("<<<"): операнд слитно или следующим словом.
+                bool here_string = (word.compare(0, 3, "<<<") == 0);
+                size_t length = here_string ? 3 : 2;
+                std::string operand;
+                if (word.size() > length) { operand = word.substr(length); }
+                else if (i + 1 < end) { operand = words[++i]; }
+                else { return false; }
+
+                if (here_string)
+                {
+                    // Переменная подставляется и в кавычках ("$VAR"), шаблоны не раскрываются.
+                    stage.input.kind = Input::Kind::HereString;
+                    stage.input.text = make_argument(operand);
+                    if (!stage.input.text.text.empty() && (stage.input.text.text[0] == '$'))
+                    {
+                        stage.input.text.kind = Argument::Kind::Variable;
+                        stage.input.text.text.erase(0, 1);
+                    }
+                    else if (stage.input.text.kind == Argument::Kind::Glob) { stage.input.text.kind = Argument::Kind::Literal; }
+                }
+                else
+                {
+                    stage.input.kind = Input::Kind::HereDocument;
+                    stage.input.heredoc = heredoc++;
+                }
+            }
+            else if (word == ">")
+            {
+                if (!stage.output.empty() || (i + 1 >= end)) { return false; }
+                stage.output = words[++i];
+            }
+            else if (stage.command.empty() && (word[0] == '@'))
+            {
+                // Модификатор размещения стадии перед командой.
+                if (!Placement::parse_option(word, stage.options)) { return false; }
+            }
+            else if (stage.command.empty() && !stage.memoized && (word == "memo"))
+            {
+                // Следующее слово - кэшируемая команда.
+                stage.memoized = true;
+            }
+            else if (stage.command.empty())
+            {
+                stage.command = word;
+                stage.builtin = Builtins::find(word);
+
+                // Поиск признака запуска пачками до конца стадии.
+                for (size_t j = i + 1; (j < end) && (words[j] != "|"); ++j)
+                { if (words[j] == "+{}") { stage.batched = true; } }
+
+                // Результат запуска пачками не кэшируется.
+                if (stage.memoized && stage.batched) { return false; }
+            }
+            else if (stage.batched && !batch_closed && (word == "+{}")) { batch_closed = true; }
+            // Аргументы после "+{}" попали бы только в последнюю пачку.
+            else if (batch_closed) { return false; }
+            else
+            {
+                // При запуске пачками постоянная часть заканчивается перед первым шаблоном.
+                Argument argument = make_argument(word);
+                argument.streamed = stage.batched && ((argument.kind == Argument::Kind::Glob) ||
+                                                      (!stage.arguments.empty() && stage.arguments.back().streamed));
+                stage.arguments.push_back(std::move(argument));
+            }
+        }
+
+        // "time" без команды только измеряет пустой конвейер.
+        if (node.stages.empty() && (stage.command.empty()) && node.time && (i == begin + 1)) { return true; }
+        if (stage.command.empty()) { return false; }
+        node.stages.push_back(std::move(stage));
+        return true;
+    }
+
+    // Построение плана по словам строки. Возвращает false при неверной структуре
+    // (пустой конвейер между операторами, "&&"/"||" в конце строки или ошибка в конвейере).
+    inline bool compile(const std::vector<std::string>& words, Plan& plan)
+    {
+        plan = Plan();
+        if (words.empty()) { return true; } // Пустой ввод - пустой план.
+
+        List list{ {}, false };
+        std::vector<bool> on_failure_edges; // Соединён ли узел с предыдущим через "||".
+        size_t begin = 0;
+        size_t heredoc_first = 0; // Номер первого here-документа текущего конвейера.
+
+        // Расстановка переходов в завершённом списке: при пропуске узла код завершения не меняется,
+        // поэтому успех ведёт к ближайшему следующему узлу после "&&", неудача - после "||".
+        auto finish_list = [&](bool background)
+        {
+            const size_t count = list.nodes.size();
+            for (size_t k = 0; k < count; ++k)
+            {
+                list.nodes[k].on_success = count;
+                list.nodes[k].on_failure = count;
+                for (size_t j = count; j-- > k + 1; )
+                {
+                    if (on_failure_edges[j]) { list.nodes[k].on_failure = j; }
+                    else                     { list.nodes[k].on_success = j; }
+                }
+            }
+            list.background = background;
+            plan.lists.push_back(std::move(list));
+            list = List{ {}, false };
+            on_failure_edges.clear();
+        };
+
+        for (size_t i = 0; i <= words.size(); ++i)
+        {
+            if ((i < words.size()) && !is_separator(words[i]))
+            {
+                // Ограничитель here-документа: "<<ОГРАНИЧИТЕЛЬ" или "<< ОГРАНИЧИТЕЛЬ".
+                if ((words[i].compare(0, 2, "<<") == 0) && (words[i].compare(0, 3, "<<<") != 0))
+                {
+                    std::string delimiter;
+                    for (char c : ((words[i].size() > 2) ? words[i].substr(2) : ((i + 1 < words.size()) ? words[i + 1] : std::string())))
+                    { if (c != '\"') { delimiter += c; } }
+                    if (delimiter.empty()) { return false; }
+                    plan.delimiters.push_back(delimiter);
+                }
+                continue;
+            }
+
+            // Конец конвейера.
+            const std::string separator = (i < words.size()) ? words[i] : std::string();
+            if (begin == i)
+            {
+                // Пустой конвейер допустим только после последнего ";" или "&" строки.
+                if ((i == words.size()) && list.nodes.empty() && !plan.lists.empty()) { break; }
+                return false;
+            }
+
+            Node node;
+            if (!compile_pipeline(words, begin, i, heredoc_first, node)) { return false; }
+            heredoc_first = plan.delimiters.size();
+
+            on_failure_edges.push_back(!list.nodes.empty() && (words[begin - 1] == "||"));
+            list.nodes.push_back(std::move(node));
+            begin = i + 1;
+
+            if ((separator == "&&") || (separator == "||")) { continue; }
+            finish_list(separator == "&");
+        }
+
+        return true;
+    }
+
+    // Кэш планов по тексту строки. При переполнении кэш очищается целиком.
+    class Cache
+    {
+    public:
+        // План строки или nullptr при неверной структуре.
+        std::shared_ptr<const Plan> get(const std::string& line)
+        {
+            auto found = plans.find(line);
+            if (found != plans.end()) { return found->second; }
+
+            auto plan = std::make_shared<Plan>();
+            if (!compile(split(line), *plan)) { return nullptr; }
+            if (plans.size() >= capacity) { plans.clear(); }
+            plans.emplace(line, plan);
+            return plan;
+        }
+
+    protected:
+        static constexpr size_t capacity = 256;
+        std::unordered_map<std::string, std::shared_ptr<const Plan>> plans;
+    };
+}
+
+#endif
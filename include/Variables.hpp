@@ -0,0 +1,33 @@
+#ifndef VARIABLES_HPP
+#define VARIABLES_HPP
+#include <string>
+#include <unordered_map>
+#include <cstdlib>
+
+// Переменные оболочки ($?, $PIPESTATUS): видны подстановке и встроенным командам,
+// но, в отличие от переменных среды, не наследуются запускаемыми программами.
+namespace Variables
+{
+    inline std::unordered_map<std::string, std::string>& store()
+    {
+        static std::unordered_map<std::string, std::string> variables;
+        return variables;
+    }
+
+    // Запись переменной оболочки.
+    inline void set(const std::string& name, const std::string& value)
+    {
+        store()[name] = value;
+    }
+
+    // Значение переменной: сначала среди переменных оболочки, затем среди переменных среды.
+    // Возвращает nullptr, если переменная не задана.
+    inline const char* get(const std::string& name)
+    {
+        auto found = store().find(name);
+        if (found != store().end()) { return found->second.c_str(); }
+        return std::getenv(name.c_str());
+    }
+}
+
+#endif
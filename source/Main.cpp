@@ -7,6 +7,8 @@
 #include <cstring>
 #include <chrono>
 #include <filesystem>
+#include <deque>
+#include <algorithm>
 //#include <regex>
 
 // Linux.
@@ -18,10 +20,41 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/times.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <climits>
 
 // Стили ANSI.
 #include "ANSI.hpp"
 
+// Размещение стадий конвейера.
+#include "Placement.hpp"
+
+// Поиск по истории команд.
+#include "HistorySearch.hpp"
+
+// Подсветка синтаксиса.
+#include "Highlight.hpp"
+
+// Хранилище аргументов для запуска пачками.
+#include "ArgumentPool.hpp"
+
+// Запись в файловые дескрипторы.
+#include "FileDescriptor.hpp"
+
+// Кэш результатов команд.
+#include "Memo.hpp"
+
+// Переменные оболочки.
+#include "Variables.hpp"
+
+// Встроенные команды.
+#include "Builtins.hpp"
+
+// План выполнения строки.
+#include "Plan.hpp"
+
 //#define DEBUG_INPUT
 //#define DEBUG_WORDS
 //#define DEBUG_ENV
@@ -43,6 +76,37 @@ inline int copy_dup2(int oldfd, int newfd)
     return copy;
 }
 
+// Файл в памяти с указанным содержимым для here-документов и here-строк.
+// Содержимое запечатывается от изменений, позиция чтения - в начале. Возвращает -1 при ошибке.
+int make_memory_file(const std::string& content)
+{
+    int fd = memfd_create("microsha-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) { fd = open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600); } // Ядра без memfd_create.
+    if (fd == -1) { return -1; }
+
+    // Запись одним вызовом: без копирования по частям и без ограничения на ёмкость pipe'а.
+    size_t written = 0;
+    while (written < content.size())
+    {
+        ssize_t count = write(fd, content.data() + written, content.size() - written);
+        if (count < 0)
+        {
+            if (errno == EINTR) { continue; }
+            close(fd);
+            return -1;
+        }
+        written += count;
+    }
+
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    if (lseek(fd, 0, SEEK_SET) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
 // Исключения процедуры запуска.
 enum class ExecutionException
 {
@@ -53,10 +117,13 @@ enum class ExecutionException
     RestoreOutput = 4,
     Fork          = 5,
     Execution     = 6,
+    Placement     = 7,
 };
 
 // Запуск исполняемого файла по указанному пути с переопределением ввода и вывода.
-pid_t execute(const std::string& path, const std::vector<std::string>& args, int input_fd, int output_fd, int close_fd = -1)
+// Массив аргументов завершается nullptr.
+pid_t execute(const char* path, char* const* args, int input_fd, int output_fd, int close_fd = -1,
+              const Placement::StageOptions& options = Placement::StageOptions())
 {
     #ifdef DEBUG_EXECUTE
     std::cout << "Ввод: " << input_fd << std::endl << "Вывод: " << output_fd << std::endl;
@@ -80,38 +147,44 @@ pid_t execute(const std::string& path, const std::vector<std::string>& args, int
         // Закрытие переданного дополнительного файлового дескриптора со стороны дочернего процесса.
         if (close_fd != -1) { close(close_fd); }
 
-        // Подготовка массива аргументов.
-        char** args_arr = new char*[args.size() + 1];
-        for(size_t i = 0; i < args.size(); ++i)
-        {
-            args_arr[i] = new char[args[i].size() + 1];
-            memcpy(args_arr[i], args[i].c_str(), args[i].size() + 1);
-        }
-        args_arr[args.size()] = NULL;
-
         #ifdef DEBUG_ENV
         std::cout << "PWD: " << std::getenv("PWD") << std::endl;
         #endif
 
-        // Стандартная обработка сигналов.
+        // Стандартная обработка сигналов (в том числе игнорируемых и заблокированных управляющими процессами).
         signal(SIGINT, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        sigset_t unblocked;
+        sigemptyset(&unblocked);
+        sigprocmask(SIG_SETMASK, &unblocked, nullptr);
+
+        // Привязка к процессорам, nice и политика планирования.
+        if (!Placement::apply(options)) { throw ExecutionException::Placement; }
 
         // Запуск.
-        if (execvp(path.c_str(), args_arr))
-        {
-            for(size_t i = 0; i < args.size(); ++i)
-            { delete[] args_arr[i]; }
-            delete[] args_arr;
-            throw ExecutionException::Execution;
-        }
+        if (execvp(path, args)) { throw ExecutionException::Execution; }
     }
 
     return process_id;
 }
 
+// Запуск с аргументами в виде массива строк.
+// Массив указателей ссылается на сами строки: после fork у ребёнка собственная копия памяти.
+pid_t execute(const std::string& path, const std::vector<std::string>& args, int input_fd, int output_fd, int close_fd = -1,
+              const Placement::StageOptions& options = Placement::StageOptions())
+{
+    std::vector<char*> args_arr;
+    args_arr.reserve(args.size() + 1);
+    for (const std::string& arg : args) { args_arr.push_back(const_cast<char*>(arg.c_str())); }
+    args_arr.push_back(nullptr);
+    return execute(path.c_str(), args_arr.data(), input_fd, output_fd, close_fd, options);
+}
+
 
 // Поиск файлов, подходящих под регулярное выражение.
-std::vector<std::filesystem::path> match_files(std::string pattern, std::filesystem::path root)
+// Найденные пути передаются в sink по одному, по мере обхода директорий.
+template <typename Sink>
+void match_files(std::string pattern, std::filesystem::path root, Sink&& sink)
 {
     // Нормализация путей.
     pattern = std::filesystem::path(pattern).lexically_normal();
@@ -132,9 +205,6 @@ std::vector<std::filesystem::path> match_files(std::string pattern, std::filesys
     // Получение левой компоненты образца.
     size_t position = pattern.find("/");
 
-    // Массив результатов поиска.
-    std::vector<std::filesystem::path> result;
-
     // Обход директорий.
     if ((position == std::string::npos) || (position == pattern.size() - 1))
     {
@@ -146,7 +216,7 @@ std::vector<std::filesystem::path> match_files(std::string pattern, std::filesys
             #endif
 
             if (fnmatch(pattern.c_str(), iterator->path().filename().c_str(), FNM_PATHNAME) == 0)
-            { result.push_back((root / iterator->path().filename()).lexically_normal()); }
+            { sink((root / iterator->path().filename()).lexically_normal()); }
         }
     }
     else
@@ -157,7 +227,7 @@ std::vector<std::filesystem::path> match_files(std::string pattern, std::filesys
         std::cout << "Разбивка: " << substring << " : " << new_pattern << std::endl;
         #endif
         if (substring == "..")
-        { result = match_files(new_pattern, root / ".."); }
+        { match_files(new_pattern, root / "..", sink); }
         else
         {
             for (auto iterator = std::filesystem::directory_iterator(root, std::filesystem::directory_options::skip_permission_denied); iterator != std::filesystem::directory_iterator(); ++iterator)
@@ -169,15 +239,246 @@ std::vector<std::filesystem::path> match_files(std::string pattern, std::filesys
                 #endif
 
                 if (fnmatch(substring.c_str(), iterator->path().filename().c_str(), FNM_PATHNAME) == 0)
-                {
-                    std::vector<std::filesystem::path> matched = match_files(new_pattern, root / iterator->path().filename());
-                    result.insert(result.end(), matched.begin(), matched.end());
-                }
+                { match_files(new_pattern, root / iterator->path().filename(), sink); }
             }
         }
     }
+}
+
+// Раскрытие слова в список файлов. Если ничего не найдено, слово передаётся как есть.
+template <typename Sink>
+void expand_word(const std::string& word, Sink&& sink)
+{
+    bool matched = false;
+    auto matched_sink = [&](const std::filesystem::path& path) { matched = true; sink(path.string()); };
+    match_files(word, (word[0] == '/') ? "/" : "./", matched_sink);
+    if (!matched) { sink(word); }
+}
+
+// Аргумент потоковой части команды, запускаемой пачками: слово-шаблон или готовое значение.
+struct StreamArgument
+{
+    std::string text;
+    bool glob;
+};
+
+// Дочерние процессы управляющего процесса (пачки или кэшируемая команда).
+// SIGTERM, посланный управляющему процессу (set -o teardown), пересылается им.
+std::deque<pid_t> driver_children;
+
+void forward_termination(int signal_number)
+{
+    for (pid_t child : driver_children) { kill(child, signal_number); }
+    _exit(128 + signal_number);
+}
+
+// Изменение списка дочерних процессов с заблокированным SIGTERM: обработчик не увидит список
+// в промежуточном состоянии и не пропустит процесс, ещё не попавший в список.
+template <typename Change>
+void change_driver_children(Change&& change)
+{
+    sigset_t blocked;
+    sigset_t previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGTERM);
+    sigprocmask(SIG_BLOCK, &blocked, &previous);
+    change();
+    sigprocmask(SIG_SETMASK, &previous, nullptr);
+}
+
+// Запуск команды пачками, как find -exec ... {} +: раскрытие шаблонов идёт потоком в компактное хранилище,
+// и каждый раз, когда очередной аргумент не укладывается в ARG_MAX, накопленная пачка запускается.
+// Одновременно работает не больше пачек, чем доступно процессоров.
+// Пачками управляет отдельный процесс, чтобы оболочка могла запустить следующие стадии конвейера,
+// которые читают вывод пачек. Возвращается его идентификатор; код завершения - наибольший из кодов пачек.
+pid_t execute_batched(const std::vector<std::string>& prefix, const std::vector<StreamArgument>& stream,
+                      int input_fd, int output_fd, int close_fd, const Placement::StageOptions& options)
+{
+    pid_t process_id = fork();
+    if (process_id == -1) { throw ExecutionException::Fork; }
+    else if (process_id) { return process_id; } // Родитель.
+
+    // Управляющий процесс.
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, forward_termination);
+    if (close_fd != -1) { close(close_fd); }
+
+    const size_t limit = ArgumentPool::limit();
+    const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t max_running = (processors > 0) ? static_cast<size_t>(processors) : 1;
+
+    // Постоянная часть каждой пачки.
+    ArgumentPool pool;
+    for (const std::string& argument : prefix) { pool.push(argument); }
+    const size_t fixed = pool.size();
+
+    std::deque<pid_t>& running = driver_children;
+    bool launched = false;
+    int result = 0;
+    auto wait_oldest = [&]()
+    {
+        int status = 0;
+        if ((waitpid(running.front(), &status, 0) != -1) && WIFEXITED(status)) { result = std::max(result, WEXITSTATUS(status)); }
+        else { result = std::max(result, 1); }
+        change_driver_children([&]() { running.pop_front(); });
+    };
+    auto flush = [&]()
+    {
+        // Пачка без потоковых аргументов запускается, только если не было ни одной другой:
+        // стадия из одних готовых аргументов выполняется один раз.
+        if ((pool.size() == fixed) && launched) { return; }
+
+        // Ожидание самой старой пачки при достижении предела одновременности.
+        if (running.size() >= max_running) { wait_oldest(); }
+
+        std::vector<char*> pointers = pool.pointers();
+        change_driver_children([&]() { running.push_back(execute(pointers[0], pointers.data(), input_fd, output_fd, close_fd, options)); });
+        pool.truncate(fixed);
+        launched = true;
+    };
+    auto sink = [&](const std::string& argument)
+    {
+        if ((pool.size() > fixed) && (pool.cost() + ArgumentPool::cost(argument) > limit)) { flush(); }
+        pool.push(argument);
+    };
+
+    try
+    {
+        for (const StreamArgument& argument : stream)
+        {
+            if (argument.glob) { expand_word(argument.text, sink); }
+            else { sink(argument.text); }
+        }
+        flush();
+    }
+    catch (const ExecutionException&)
+    {
+        // Сюда попадают как ошибки управляющего процесса, так и неудавшийся exec в пачке.
+        std::cerr << "Не удалось выполнить пачку команды " << prefix[0] << std::endl;
+        _exit(127);
+    }
+
+    while (!running.empty()) { wait_oldest(); }
+    _exit(result);
+}
+
+// Запуск встроенной команды без fork: вывод пишется прямо в output_fd.
+// Отдельный процесс порождается, только если команда меняет состояние оболочки внутри конвейера
+// или её вывод не помещается в pipe, который следующая стадия ещё не начала читать.
+// Возвращает идентификатор процесса или -1, если команда выполнена на месте (код - в status).
+pid_t execute_builtin(const Builtins::Builtin& builtin, const std::vector<std::string>& args, int output_fd, int close_fd, bool pipeline, int& status)
+{
+    // Порядок вывода оболочки и команды сохраняется.
+    std::cout.flush();
+
+    std::string output;
+    bool in_place = !(builtin.modifies_state && pipeline);
+    if (in_place)
+    {
+        status = builtin.function(args, output);
+
+        // Свободное место в pipe'е: ёмкость за вычетом ещё не прочитанного.
+        struct stat info;
+        if ((fstat(output_fd, &info) == 0) && S_ISFIFO(info.st_mode))
+        {
+            int capacity = fcntl(output_fd, F_GETPIPE_SZ);
+            int queued = 0;
+            if ((capacity == -1) || (ioctl(output_fd, FIONREAD, &queued) == -1)) { capacity = PIPE_BUF; queued = 0; }
+            in_place = (output.size() <= static_cast<size_t>(capacity - queued));
+        }
+
+        if (in_place)
+        {
+            write_all(output_fd, output.data(), output.size());
+            return -1;
+        }
+    }
+
+    pid_t process_id = fork();
+    if (process_id == -1) { throw ExecutionException::Fork; }
+    else if (process_id) { return process_id; } // Родитель.
+
+    // Ребёнок: выполнение команды (если она ещё не выполнена) и запись вывода.
+    signal(SIGINT, SIG_DFL);
+    if (close_fd != -1) { close(close_fd); }
+    if (builtin.modifies_state) { status = builtin.function(args, output); }
+    write_all(output_fd, output.data(), output.size());
+    _exit(status);
+}
+
+// Запуск команды с кэшированием результата (memo команда ...).
+// При попадании сохранённый вывод отдаётся через sendfile, иначе вывод команды одновременно
+// пересылается в output_fd и записывается в кэш. Как и при запуске пачками, работу выполняет
+// отдельный процесс; его код завершения - код команды.
+pid_t execute_memoized(const std::vector<std::string>& args, int input_fd, int output_fd, int close_fd, const Placement::StageOptions& options)
+{
+    pid_t process_id = fork();
+    if (process_id == -1) { throw ExecutionException::Fork; }
+    else if (process_id) { return process_id; } // Родитель.
+
+    // Управляющий процесс. Закрытие вывода читателем обрабатывается по ошибке записи, а не сигналом.
+    signal(SIGINT, SIG_DFL);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, forward_termination);
+    if (close_fd != -1) { close(close_fd); }
+
+    Memo::Cache cache;
+    std::string key;
+    int status = 0;
+    bool cacheable = Memo::key(args, input_fd, key);
+    if (cacheable && cache.replay(key, output_fd, status)) { _exit(status); }
+
+    try
+    {
+        // Вывод команды перехватывается через pipe.
+        int capture[2];
+        if (pipe(capture)) { _exit(1); }
+        pid_t child = -1;
+        change_driver_children([&]()
+        {
+            child = execute(args[0], args, input_fd, capture[1], capture[0], options);
+            driver_children.push_back(child);
+        });
+        close(capture[1]);
+
+        if (cacheable) { cacheable = cache.begin(key); }
+        char buffer[1 << 16];
+        ssize_t count = 0;
+        while ((count = read(capture[0], buffer, sizeof(buffer))) != 0)
+        {
+            if (count < 0)
+            {
+                if (errno == EINTR) { continue; }
+                break;
+            }
+
+            // Читатель закрыл вывод: результат неполон, команда останавливается.
+            if (!write_all(output_fd, buffer, count))
+            {
+                cache.abort();
+                kill(child, SIGTERM);
+                break;
+            }
+            if (cacheable) { cache.write(buffer, count); }
+        }
+        close(capture[0]);
+        cacheable = cacheable && cache.writing();
 
-    return result;
+        // Сохраняется только результат нормального завершения.
+        if ((waitpid(child, &status, 0) == -1) || !WIFEXITED(status))
+        {
+            cache.abort();
+            _exit(WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1);
+        }
+        if (cacheable) { cache.commit(WEXITSTATUS(status)); }
+        _exit(WEXITSTATUS(status));
+    }
+    catch (const ExecutionException&)
+    {
+        // Сюда попадают как ошибки управляющего процесса, так и неудавшийся exec команды.
+        std::cerr << "Не удалось выполнить команду " << args[0] << std::endl;
+        _exit(127);
+    }
 }
 
 
@@ -193,6 +494,7 @@ int main(int argc, char* argv[])
         Pipe      = 3,
         File      = 4,
         Env       = 5,
+        TooLong   = 6,
     };
 
     // Модификаторы консоли.
@@ -230,9 +532,362 @@ int main(int argc, char* argv[])
 
     // История команд.
     std::vector<std::string> history;
+    HistorySearch::Index history_index; // Упакованная копия истории для поиска.
+
+    // Индекс команд и подсветка вводимой строки.
+    Highlight::CommandIndex command_index;
+    for (const char* builtin : { "exit", "time", "memo" }) { command_index.add_builtin(builtin); }
+    for (const auto& builtin : Builtins::table()) { command_index.add_builtin(builtin.first); }
+    Highlight::Highlighter highlighter(command_index);
+
+    // Автоматическое размещение стадий конвейеров по процессорам.
+    Placement::AutoPlacer auto_placer;
+
+    // Параметры оболочки, изменяемые командами "set -o имя" и "set +o имя".
+    struct Options
+    {
+        bool pipefail = false; // Код конвейера - последний ненулевой код стадии, а не код последней стадии.
+        bool teardown = false; // После завершения последней стадии остальным посылается SIGTERM.
+    } options;
+
+    // Запись кода завершения в переменные оболочки: $? - код конвейера, $PIPESTATUS - коды всех стадий.
+    auto set_status = [&options](const std::vector<int>& statuses) -> int
+    {
+        int result = statuses.empty() ? 0 : statuses.back();
+        std::string pipestatus;
+        for (int status : statuses)
+        {
+            if (options.pipefail && (status != 0)) { result = status; }
+            pipestatus += (pipestatus.empty() ? "" : " ") + std::to_string(status);
+        }
+        Variables::set("PIPESTATUS", pipestatus);
+        Variables::set("?", std::to_string(result));
+        return result;
+    };
+
+    bool terminated = false; // Введена команда exit.
+
+    // Процесс оболочки: ошибки запуска в дочерних процессах завершают только их.
+    pid_t shell_pid = getpid();
+
+    // Кэш планов выполнения строк.
+    Plan::Cache plans;
+
+    // Сообщение об ошибке разбора или встроенной команды.
+    auto report = [](MainException exception)
+    {
+        switch (exception)
+        {
+            case MainException::OK: { break; }
+            case MainException::Execution: { break; } // Сообщение уже выведено.
+            case MainException::Structure:
+            {
+                std::cerr << "Неверная структура команды." << std::endl;
+                break;
+            }
+            case MainException::Pipe:
+            {
+                std::cerr << "Ошибка при открытии pipe." << std::endl;
+                break;
+            }
+            case MainException::File:
+            {
+                std::cerr << "Ошибка при открытии файла." << std::endl;
+                break;
+            }
+            case MainException::Env:
+            {
+                std::cerr << "Ошибка операции с переменной среды." << std::endl;
+                break;
+            }
+            case MainException::TooLong:
+            {
+                std::cerr << "Список аргументов превышает ARG_MAX, используйте запуск пачками: команда ... +{}" << std::endl;
+                break;
+            }
+        }
+    };
+
+    // Значение переменной оболочки или среды для подстановки.
+    auto lookup = [](const std::string& name) -> std::string
+    {
+        const char* ptr = Variables::get(name);
+        if (ptr == nullptr) { throw MainException::Env; }
+        return ptr;
+    };
+
+    // Выполнение одного конвейера плана. Возвращает код завершения ($?).
+    // heredocs - тела here-документов строки.
+    auto run_pipeline = [&](const Plan::Node& node, std::vector<std::string>& heredocs) -> int
+    {
+        int result = 0;
+        try
+        {
+            // Переменные для измерения времени выполнения.
+            tms times_first;
+            std::chrono::time_point<std::chrono::system_clock> real_time_first;
+
+            // Сначала обработка команд самой оболочки.
+            if (node.control == Plan::Control::Exit) { terminated = true; return 0; }
+            else if (node.control == Plan::Control::SetOption)
+            {
+                // Включение (-o) и выключение (+o) параметров оболочки.
+                if      (node.option == "pipefail") { options.pipefail = node.option_value; }
+                else if (node.option == "teardown") { options.teardown = node.option_value; }
+                else { throw MainException::Structure; }
+                result = set_status({ 0 });
+            }
+            else if (node.control == Plan::Control::MemoStats)
+            {
+                Memo::Cache().stats(std::cout);
+                result = set_status({ 0 });
+            }
+            else
+            {
+                // Файловые дескрипторы для стандартного ввода и вывода запускаемых процессов.
+                int input_fd = 0;
+                int output_fd = 1;
+
+                // Обработка команды time.
+                if (node.time)
+                {
+                    times(&times_first);
+                    real_time_first = std::chrono::system_clock::now();
+                }
+
+                auto_placer.begin_pipeline();
+
+                // Идентификаторы процессов стадий (-1 - встроенная команда, выполненная на месте) и их коды завершения.
+                std::vector<pid_t> pids;
+                std::vector<int> statuses;
+                const bool pipeline = (node.stages.size() > 1);
+
+                for (size_t stage = 0; stage < node.stages.size(); ++stage)
+                {
+                    const Plan::Stage& current = node.stages[stage];
+
+                    // Аргументы после подстановки переменных и раскрытия шаблонов. При запуске пачками
+                    // аргументы, начиная с первого шаблона, уходят в stream и раскрываются уже при запуске.
+                    std::vector<std::string> arguments{ current.command };
+                    std::vector<StreamArgument> stream;
+
+                    // Вход pipe'а для следующей стадии.
+                    int next_input_fd = 0;
+
+                    // Закрытие дескрипторов стадии при ошибке.
+                    auto close_stage = [&]()
+                    {
+                        if (input_fd != 0)      { close(input_fd); }
+                        if (output_fd != 1)     { close(output_fd); }
+                        if (next_input_fd != 0) { close(next_input_fd); }
+                    };
+
+                    // Здесь возможен запуск процесса.
+                    try
+                    {
+                        for (const Plan::Argument& argument : current.arguments)
+                        {
+                            switch (argument.kind)
+                            {
+                                case Plan::Argument::Kind::Literal:
+                                {
+                                    if (argument.streamed) { stream.push_back(StreamArgument{ argument.text, false }); }
+                                    else { arguments.push_back(argument.text); }
+                                    break;
+                                }
+                                case Plan::Argument::Kind::Variable:
+                                {
+                                    if (argument.streamed) { stream.push_back(StreamArgument{ lookup(argument.text), false }); }
+                                    else { arguments.push_back(lookup(argument.text)); }
+                                    break;
+                                }
+                                case Plan::Argument::Kind::Glob:
+                                {
+                                    if (argument.streamed) { stream.push_back(StreamArgument{ argument.text, true }); }
+                                    else { expand_word(argument.text, [&](const std::string& path) { arguments.push_back(path); }); }
+                                    break;
+                                }
+                            }
+                        }
+
+                        // Перенаправление ввода. Here-документы и here-строки передаются через файл в памяти.
+                        std::string content;
+                        switch (current.input.kind)
+                        {
+                            case Plan::Input::Kind::None: { break; }
+                            case Plan::Input::Kind::File:
+                            {
+                                int fd = open(current.input.path.c_str(), O_RDWR);
+                                if (fd == -1) { throw MainException::File; }
+                                input_fd = fd;
+                                break;
+                            }
+                            case Plan::Input::Kind::HereDocument: { content.swap(heredocs[current.input.heredoc]); break; }
+                            case Plan::Input::Kind::HereString:
+                            {
+                                const Plan::Argument& text = current.input.text;
+                                content = (text.kind == Plan::Argument::Kind::Variable) ? lookup(text.text) : text.text;
+                                content += '\n';
+                                break;
+                            }
+                        }
+                        if ((current.input.kind == Plan::Input::Kind::HereDocument) || (current.input.kind == Plan::Input::Kind::HereString))
+                        {
+                            int fd = make_memory_file(content);
+                            if (fd == -1) { throw MainException::File; }
+                            input_fd = fd;
+                        }
+
+                        // Перенаправление вывода в pipe к следующей стадии или в файл.
+                        if (stage + 1 < node.stages.size())
+                        {
+                            int pipefd[2];
+                            if (pipe(pipefd)) { throw MainException::Pipe; }
+                            next_input_fd = pipefd[0];
+                            output_fd = pipefd[1];
+                        }
+                        else if (!current.output.empty())
+                        {
+                            int fd = open(current.output.c_str(), O_RDWR | O_CREAT, 0666);
+                            if (fd == -1) { throw MainException::File; }
+                            output_fd = fd;
+                        }
+
+                        // Запуск стадии с закрытием входа pipe'а со стороны дочернего процесса.
+                        Placement::StageOptions stage_options = current.options;
+                        if (stage_options.auto_affinity && !auto_placer.place(stage, stage_options.cpus)) { stage_options.auto_affinity = false; }
+                        const int close_fd = (next_input_fd != 0) ? next_input_fd : -1;
+                        statuses.push_back(0);
+
+                        if (current.builtin && !current.batched && !current.memoized)
+                        { pids.push_back(execute_builtin(*current.builtin, arguments, output_fd, close_fd, pipeline, statuses.back())); }
+                        else if (current.batched)
+                        { pids.push_back(execute_batched(arguments, stream, input_fd, output_fd, close_fd, stage_options)); }
+                        else if (current.memoized)
+                        { pids.push_back(execute_memoized(arguments, input_fd, output_fd, close_fd, stage_options)); }
+                        else
+                        {
+                            // Слишком длинный список аргументов exec всё равно отвергнет с E2BIG.
+                            if (ArgumentPool::cost(arguments) > ArgumentPool::limit()) { throw MainException::TooLong; }
+                            pids.push_back(execute(arguments[0], arguments, input_fd, output_fd, close_fd, stage_options));
+                        }
+                    }
+                    catch (const MainException&)
+                    {
+                        close_stage();
+                        throw;
+                    }
+                    catch (const ExecutionException& exception)
+                    {
+                        switch (exception)
+                        {
+                            case ExecutionException::OK: { break; }
+                            case ExecutionException::ChangeInput:
+                            {
+                                std::cerr << "Не удалось переопределить стандартный ввод для исполняемой команды." << std::endl;
+                                break;
+                            }
+                            case ExecutionException::ChangeOutput:
+                            {
+                                std::cerr << "Не удалось переопределить стандартный вывод для исполняемой команды." << std::endl;
+                                break;
+                            }
+                            case ExecutionException::RestoreInput:
+                            {
+                                std::cerr << "Не удалось переопределить стандартный ввод для оболочки." << std::endl;
+                                break;
+                            }
+                            case ExecutionException::RestoreOutput:
+                            {
+                                std::cerr << "Не удалось переопределить стандартный вывод для оболочки." << std::endl;
+                                break;
+                            }
+                            case ExecutionException::Fork:
+                            {
+                                std::cerr << "Ошибка системного вызова fork." << std::endl;
+                                break;
+                            }
+                            case ExecutionException::Execution:
+                            {
+                                std::cerr << "Не удалось выполнить команду " << arguments[0] << std::endl;
+                                break;
+                            }
+                            case ExecutionException::Placement:
+                            {
+                                std::cerr << "Не удалось применить параметры размещения для команды " << arguments[0] << std::endl;
+                                break;
+                            }
+                        }
+                        // Ошибка в дочернем процессе после fork: завершается только он, оболочка продолжает работу.
+                        if (getpid() != shell_pid) { _exit((exception == ExecutionException::Execution) ? 127 : 126); }
+                        close_stage();
+                        throw MainException::Execution;
+                    }
+
+                    // Обработка нестандартных файловых дескрипторов родителем.
+                    if (input_fd != 0)  { close(input_fd); }
+                    if (output_fd != 1) { close(output_fd); }
+
+                    // Перенаправление ввода/вывода для следующего процесса.
+                    input_fd = next_input_fd;
+                    output_fd = 1;
+                }
+
+                // Игнорирование сигнала прерывания.
+                signal(SIGINT, SIG_IGN);
+
+                // Ожидание стадий конвейера с запоминанием кодов завершения.
+                // Списки, запущенные через "&", ожидаются отдельно после выполнения всей строки.
+                std::vector<bool> finished(pids.size(), false);
+                for (size_t k = 0; k < pids.size(); ++k) { finished[k] = (pids[k] == -1); }
+                auto tear_down = [&]()
+                {
+                    for (size_t k = 0; k + 1 < pids.size(); ++k)
+                    { if (!finished[k]) { kill(pids[k], SIGTERM); } }
+                };
+                if (options.teardown && !pids.empty() && finished.back()) { tear_down(); }
+
+                pid_t wpid = 0;
+                int status = 0;
+                while ((std::find(finished.begin(), finished.end(), false) != finished.end()) && ((wpid = wait(&status)) > 0))
+                {
+                    size_t index = std::find(pids.begin(), pids.end(), wpid) - pids.begin();
+                    if (index == pids.size()) { continue; }
+                    statuses[index] = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                    finished[index] = true;
+
+                    // Завершение последней стадии: вывод остальных больше никто не прочтёт.
+                    if (options.teardown && (index + 1 == pids.size())) { tear_down(); }
+                }
+                result = set_status(statuses);
+
+                // Стандартная обработка сигналов.
+                signal(SIGINT, SIG_DFL);
+
+                // Вывод времени работы детей.
+                if (node.time)
+                {
+                    tms times_second;
+                    times(&times_second);
+                    auto real_time_second = std::chrono::system_clock::now();
+                    std::cout << std::fixed << std::setprecision(3) << std::endl
+                              << "real:\t" << std::chrono::duration<double>(real_time_second - real_time_first).count() << "ms" << std::endl
+                              << "user:\t" << 1000.0 * (times_second.tms_cutime - times_first.tms_cutime) / CLOCKS_PER_SEC << "ms" << std::endl
+                              << "sys:\t"  << 1000.0 * (times_second.tms_cstime - times_first.tms_cstime) / CLOCKS_PER_SEC << "ms" << std::endl
+                              << std::defaultfloat;
+                }
+            }
+        }
+        catch (const MainException& exception)
+        {
+            // Ошибка прерывает только этот конвейер: выполнение строки продолжается по плану.
+            result = set_status({ 1 });
+            report(exception);
+        }
+        return result;
+    };
 
     // Основной цикл работы.
-    bool terminated = false;
     while (!terminated)
     {
         try
@@ -255,16 +910,33 @@ int main(int argc, char* argv[])
                 size_t history_pos = history.size(); // Текущая команда из истории.
                 size_t cursor_pos  = 0;              // Положение курсора.
 
+                // Состояние поиска по истории (Ctrl + R).
+                bool searching = false;
+                std::string search_query;
+                size_t search_pos = 0; // Текущий результат поиска.
+
                 // Перенастройка терминала в специальный режим.
                 TermiosSection termios_section;
 
+                // Обновление индекса команд один раз на строку.
+                command_index.refresh();
+
                 // Цикл обработки ввода.
                 while (true)
                 {
                     // Текущий вид команды:
                     std::string& echo = ((history_pos == history.size()) ? input : history[history_pos]);
-                    std::cout << "\33[2K\r" << info << echo;
-                    for (size_t i = echo.size(); i > cursor_pos; --i) { std::cout << "\b"; }
+                    if (searching)
+                    {
+                        const std::vector<size_t>& results = history_index.results();
+                        std::cout << "\33[2K\r" << "(поиск)`" << search_query << "': "
+                                  << (results.empty() ? std::string() : history_index.entry(results[search_pos]));
+                    }
+                    else
+                    {
+                        std::cout << "\33[2K\r" << info << highlighter.render(echo);
+                        for (size_t i = echo.size(); i > cursor_pos; --i) { std::cout << "\b"; }
+                    }
 
                     // Получение нажатой клавиши.
                     int key = getchar();
@@ -281,6 +953,54 @@ int main(int argc, char* argv[])
                         return 0;
                     }
 
+                    // Поиск по истории.
+                    if (searching)
+                    {
+                        // Ctrl + R - следующий результат.
+                        if (key == 18)
+                        {
+                            if (search_pos + 1 < history_index.results().size()) { ++search_pos; }
+                            continue;
+                        }
+
+                        // Ctrl + G - отмена поиска.
+                        if (key == 7)
+                        {
+                            searching = false;
+                            continue;
+                        }
+
+                        // Backspace и обычные символы изменяют запрос.
+                        if ((key == 127) || (key >= 32))
+                        {
+                            if (key == 127)
+                            {
+                                if (search_query.empty()) { continue; }
+                                search_query.pop_back();
+                            }
+                            else { search_query.push_back(key); }
+
+                            history_index.search(search_query);
+                            search_pos = 0;
+                            continue;
+                        }
+
+                        // Остальные клавиши принимают найденную команду и обрабатываются как обычно.
+                        const std::vector<size_t>& results = history_index.results();
+                        if (!results.empty()) { input = history_index.entry(results[search_pos]); }
+                        history_pos = history.size();
+                        cursor_pos = input.size();
+                        searching = false;
+                    }
+                    else if (key == 18)
+                    {
+                        searching = true;
+                        search_query.clear();
+                        history_index.search(search_query);
+                        search_pos = 0;
+                        continue;
+                    }
+
                     if (key == 27)
                     {
                         switch (getchar())
@@ -377,7 +1097,11 @@ int main(int argc, char* argv[])
                     {
                         std::cout << std::endl;
                         // Если команда не пустая и не совпадает с последней командой из истории, происходит её запоминание.
-                        if (!input.empty() && (history.empty() || (input != history[history.size() - 1]))) { history.push_back(input); }
+                        if (!input.empty() && (history.empty() || (input != history[history.size() - 1])))
+                        {
+                            history.push_back(input);
+                            history_index.add(input);
+                        }
                         break;
                     }
 
@@ -409,354 +1133,93 @@ int main(int argc, char* argv[])
             std::cout << input << std::endl;
             #endif
 
-            // Переменные для измерения времени выполнения.
-            bool time = false;
-            tms times_first;
-            std::chrono::time_point<std::chrono::system_clock> real_time_first;
+            // План выполнения строки: разбирается один раз и переиспользуется при повторном вводе той же строки.
+            std::shared_ptr<const Plan::Plan> plan = plans.get(input);
+            if (!plan) { throw MainException::Structure; }
 
-            // Массив введённых слов.
-            std::vector<std::string> words;
+            // Пустой ввод.
+            if (plan->lists.empty()) { continue; }
 
-            // Разбиение ввода на слова с учётом символов ' " '.
+            #ifdef DEBUG_WORDS
+            std::cout << "Разобранные слова:" << std::endl;
+            for (const Plan::List& list : plan->lists)
             {
-                // Состояния ДКА.
-                enum class States
-                {
-                    Whitespace = 0,
-                    Quoted     = 1,
-                    Unquoted   = 2,
-                };
-                States state = States::Whitespace;
-                for (size_t i = 0; i < input.size(); ++i)
+                for (const Plan::Node& node : list.nodes)
                 {
-                    switch (state)
+                    for (const Plan::Stage& stage : node.stages)
                     {
-                        case States::Whitespace:
-                        {
-                            switch (input[i])
-                            {
-                                case ' ':  { break; }
-                                case '\t': { break; }
-                                case '\"':
-                                {
-                                    state = States::Quoted;
-                                    words.push_back(""); // Встретился непустой символ - создаётся новое слово.
-                                    break;
-                                }
-                                default:
-                                {
-                                    state = States::Unquoted;
-                                    words.push_back(""); // Встретился непустой символ - создаётся новое слово.
-                                    break;
-                                }
-                            }
-                            break;
-                        }
-                        case States::Quoted:
-                        {
-                            switch (input[i])
-                            {
-                                case '\"': { state = States::Unquoted; break; }
-                                default:   { break; }
-                            }
-                            break;
-                        }
-                        case States::Unquoted:
-                        {
-                            switch (input[i])
-                            {
-                                case ' ':  { state = States::Whitespace; break; }
-                                case '\t': { state = States::Whitespace; break; }
-                                case '\"': { state = States::Quoted; break; }
-                                default:   { break; }
-                            }
-                            break;
-                        }
+                        std::cout << stage.command << std::endl;
+                        for (const Plan::Argument& argument : stage.arguments) { std::cout << argument.text << std::endl; }
                     }
-
-                    // Если символ не пустой, добавляем в слово.
-                    //if ((state != States::Whitespace) && (input[i] != '\"'))
-                    if (state != States::Whitespace)
-                    { words[words.size() - 1].push_back(input[i]); }
                 }
-
-                #ifdef DEBUG_WORDS
-                std::cout << "Разобранные слова:" << std::endl;
-                for (size_t i = 0; i < words.size(); ++i) { std::cout << words[i] << std::endl; }
-                #endif
             }
+            #endif
 
-            // Пустой ввод.
-            if (words.empty()) { continue; }
-
-            // Разбор введённых слов.
-            // Сначала обработка встроенных команд.
-            if (words[0] == "exit") { terminated = true; break; }
-            else if (words[0] == "cd")
+            // Чтение тел here-документов ("<<ОГРАНИЧИТЕЛЬ" или "<< ОГРАНИЧИТЕЛЬ"): следующие строки до строки-ограничителя.
+            std::vector<std::string> heredocs;
+            for (const std::string& delimiter : plan->delimiters)
             {
-                if (words.size() < 2)
-                { if (chdir(std::getenv("HOME"))) { throw MainException::File; } }
-                else
-                { if (chdir(words[1].c_str())) { throw MainException::File; } }
-            }
-            else if (words[0] == "set")
-            {
-                // Ищем разделитель - знак "=".
-                size_t delimeter_position = 0; // Положение разделителя.
-                if ((words.size() < 2) || ((delimeter_position = words[1].find("=")) == std::string::npos)) { throw MainException::Structure; }
-                size_t size = words[1].size();
-
-                // Положения и длины требуемых подстрок.
-                size_t name_position  = 0;
-                size_t name_length    = delimeter_position;
-                size_t value_position = delimeter_position + 1;
-                size_t value_length   = size - value_position;
-
-                // Обработка кавычек.
-                #ifdef DEBUG_ENV
-                std::cout << variable << " = " << value << std::endl;
-                std::cout << "value_position: " << value_position << ": " << words[1][value_position] << "  "
-                          << "value_position + value_lenth - 1: " << value_position + value_length << ": " << words[1][value_position + value_length - 1] << std::endl;
-                #endif
-                if ((value_length > 1) && (words[1][value_position] == '\"') && (words[1][value_position + value_length - 1] == '\"'))
+                std::string body;
+                std::string line;
+                while ((std::cout << "> " << std::flush) && std::getline(std::cin, line) && (line != delimiter))
                 {
-                    ++value_position;
-                    value_length -= 2;
+                    body += line;
+                    body += '\n';
                 }
-
-                std::string variable = words[1].substr(name_position, name_length);
-                std::string value = words[1].substr(value_position, value_length);
-
-                #ifdef DEBUG_ENV
-                std::cout << variable << " = " << value << std::endl;
-                #endif
-                setenv(variable.c_str(), value.c_str(), 1);
+                std::cin.clear();
+                heredocs.push_back(std::move(body));
             }
-            else if (words[0] == "get")
-            {
-                if (words.size() < 2) { throw MainException::Structure; }
-                char* ptr = std::getenv(words[1].c_str());
-                if (ptr == nullptr) { throw MainException::Env; }
-                std::cout << ptr << std::endl;
-            }
-            else
-            {
-                // Файловые дескрипторы для стандартного ввода и вывода запускаемых процессов.
-                int input_fd = 0;
-                int output_fd = 1;
 
-                // Обработка команды time.
-                size_t i = 0;
-                if (words.size() > 0 && words[0] == "time")
-                {
-                    time = true;
-                    i = 1;
-                    times(&times_first);
-                    real_time_first = std::chrono::system_clock::now();
-                }
-
-                std::vector<std::string> arguments;
-                for (; i < words.size(); ++i)
+            // Выполнение плана. Списки, завершённые "&", выполняются в отдельных процессах одновременно с последующими.
+            std::vector<pid_t> background;
+            for (const Plan::List& list : plan->lists)
+            {
+                if (list.background)
                 {
-                    // Здесь возможен запуск процесса.
-                    try
+                    std::cout.flush();
+                    pid_t process_id = fork();
+                    if (process_id == -1)
                     {
-                        if (words[i] == "|")
-                        {
-                            if (output_fd != 1) { throw MainException::Structure; } // Вывод уже переопределён.
-                            else
-                            {
-                                // Создание pipe'а.
-                                int pipefd[2];
-                                if (pipe(pipefd)) { throw MainException::Pipe; }
-
-                                // Перенаправление вывода от запускаемого процесса в pipe.
-                                output_fd = pipefd[1];
-
-                                // Запуск процесса.
-                                execute(arguments[0], arguments, input_fd, output_fd, pipefd[0]); // Запуск с закрытием ввода pipe'а со стороны дочернего процесса.
-                                close(output_fd);                                                 // Закрытие вывода pipe со стороны родителя.
-
-                                // Обработка входного конца pipe.
-                                if (input_fd != 0) { close(input_fd); }
-
-                                // Очистка аргументов.
-                                arguments.clear();
-
-                                // Перенаправление ввода/вывода для следующего процесса.
-                                input_fd = pipefd[0];
-                                output_fd = 1;
-                            }
-                        }
-                        else if (words[i] == "<")
-                        {
-                            if (input_fd != 0) { throw MainException::Structure; } // Ввод уже переопределён.
-                            else
-                            {
-                                if ((i + 1 >= words.size()) || ( (input_fd = open(words[i + 1].c_str(), O_RDWR)) == -1 )) { throw MainException::File; }
-                                else { ++i; }
-                            }
-                        }
-                        else if (words[i] == ">")
-                        {
-                            if (output_fd != 1) { throw MainException::Structure; } // Вывод уже переопределён.
-                            else
-                            {
-                                if ((i + 1 >= words.size()) || ( (output_fd = open(words[i + 1].c_str(), O_RDWR | O_CREAT, 0666)) == -1)) { throw MainException::File; }
-                                else { ++i; }
-                            }
-                        }
-                        else
-                        {
-                            // Если список аргументов пустой, первый аргумент - имя исполняемой команды, передаётся неизменным.
-                            if (arguments.empty())
-                            {
-                                arguments.push_back(words[i]);
-                            }
-                            // Иначе, проверка на переменную среды. Если не переменная среды, производится поиск подходящих под регулярное выражение аргументов.
-                            else
-                            {
-                                // Чистка слова от двойных кавычек.
-                                // TODO: убрать этот костыль.
-                                std::string cleaned;
-                                cleaned.reserve(words[i].size());
-                                for(size_t j = 0; j < words[i].size(); ++j)
-                                { if(words[i][j] != '\"') { cleaned += words[i][j]; } }
-
-                                // Переменная среды.
-                                if (words[i][0] == '$')
-                                {
-                                    // Получение имени переменной.
-                                    std::string variable_name = cleaned.substr(1, cleaned.size() - 1);
-
-                                    // Получение значения переменной.
-                                    char* ptr = std::getenv(variable_name.c_str());
-                                    if (ptr == nullptr) { throw MainException::Env; }
-
-                                    // Запись значения.
-                                    arguments.push_back(std::string(ptr));
-                                }
-                                else
-                                {
-                                    std::vector<std::filesystem::path> matched = (cleaned[0] == '/') ? match_files(cleaned, "/") : match_files(cleaned, "./");
-                                    if (matched.empty())
-                                    { arguments.push_back(cleaned); }
-                                    else
-                                    { arguments.insert(arguments.end(), matched.begin(), matched.end()); }
-                                }
-                            }
-                        }
-
-                        if (i + 1 == words.size())
-                        {
-                            // Запуск процесса.
-                            execute(arguments[0], arguments, input_fd, output_fd);
-
-                            // Обработка нестандартных файловых дискрипторов.
-                            if (input_fd != 0)  { close(input_fd); }
-                            if (output_fd != 1) { close(output_fd); }
-
-                            // Очистка аргументов.
-                            arguments.clear();
-
-                            // Перенаправление ввода/вывода для следующего процесса.
-                            input_fd = 0;
-                            output_fd = 1;
-                        }
+                        std::cerr << "Ошибка системного вызова fork." << std::endl;
+                        set_status({ 1 });
+                        continue;
                     }
-                    catch (const ExecutionException& exception)
+                    else if (process_id) // Родитель.
                     {
-                        switch (exception)
-                        {
-                            case ExecutionException::OK: { break; }
-                            case ExecutionException::ChangeInput:
-                            {
-                                std::cerr << "Не удалось переопределить стандартный ввод для исполняемой команды." << std::endl;
-                                break;
-                            }
-                            case ExecutionException::ChangeOutput:
-                            {
-                                std::cerr << "Не удалось переопределить стандартный вывод для исполняемой команды." << std::endl;
-                                break;
-                            }
-                            case ExecutionException::RestoreInput:
-                            {
-                                std::cerr << "Не удалось переопределить стандартный ввод для оболочки." << std::endl;
-                                break;
-                            }
-                            case ExecutionException::RestoreOutput:
-                            {
-                                std::cerr << "Не удалось переопределить стандартный вывод для оболочки." << std::endl;
-                                break;
-                            }
-                            case ExecutionException::Fork:
-                            {
-                                std::cerr << "Ошибка системного вызова fork." << std::endl;
-                                break;
-                            }
-                            case ExecutionException::Execution:
-                            {
-                                std::cerr << "Не удалось выполнить команду " << arguments[0] << std::endl;
-                                break;
-                            }
-                        }
-                        throw MainException::Execution;
+                        background.push_back(process_id);
+                        set_status({ 0 });
+                        continue;
                     }
+                    shell_pid = getpid(); // Ребёнок выполняет список как отдельная оболочка.
                 }
 
-                // Игнорирование сигнала прерывания.
-                signal(SIGINT, SIG_IGN);
-
-                // Ожидание порождённых процессов.
-                pid_t wpid = 0;
+                // Переходы по узлам списка в зависимости от кодов завершения.
                 int status = 0;
-                while ((wpid = wait(&status)) > 0);
-
-                // Стандартная обработка сигналов.
-                signal(SIGINT, SIG_DFL);
+                for (size_t k = 0; !terminated && (k < list.nodes.size()); )
+                {
+                    const Plan::Node& node = list.nodes[k];
+                    status = run_pipeline(node, heredocs);
+                    k = (status == 0) ? node.on_success : node.on_failure;
+                }
 
-                // Вывод времени работы детей.
-                if (time)
+                if (list.background)
                 {
-                    tms times_second;
-                    times(&times_second);
-                    auto real_time_second = std::chrono::system_clock::now();
-                    std::cout << std::fixed << std::setprecision(3) << std::endl
-                              << "real:\t" << std::chrono::duration<double>(real_time_second - real_time_first).count() << "ms" << std::endl
-                              << "user:\t" << 1000.0 * (times_second.tms_cutime - times_first.tms_cutime) / CLOCKS_PER_SEC << "ms" << std::endl
-                              << "sys:\t"  << 1000.0 * (times_second.tms_cstime - times_first.tms_cstime) / CLOCKS_PER_SEC << "ms" << std::endl
-                              << std::defaultfloat;
+                    std::cout.flush();
+                    _exit(status);
                 }
+                if (terminated) { break; }
             }
+
+            // Ожидание списков, запущенных одновременно.
+            signal(SIGINT, SIG_IGN);
+            for (pid_t process_id : background) { waitpid(process_id, nullptr, 0); }
+            signal(SIGINT, SIG_DFL);
         }
         catch (const MainException& exception)
         {
-            switch (exception)
-            {
-                case MainException::OK: { break; }
-                case MainException::Execution: { return 0; break; }
-                case MainException::Structure:
-                {
-                    std::cerr << "Неверная структура команды." << std::endl;
-                    break;
-                }
-                case MainException::Pipe:
-                {
-                    std::cerr << "Ошибка при открытии pipe." << std::endl;
-                    break;
-                }
-                case MainException::File:
-                {
-                    std::cerr << "Ошибка при открытии файла." << std::endl;
-                    break;
-                }
-                case MainException::Env:
-                {
-                    std::cerr << "Ошибка операции с переменной среды." << std::endl;
-                    break;
-                }
-            }
-            //return 0;
+            // Ошибка разбора.
+            set_status({ 1 });
+            report(exception);
         }
     }
 